@@ -0,0 +1,156 @@
+// /proc/net/dev 解析基准测试
+// 生成一个包含 5000 个网卡的合成文件，对比：
+//   legacy: 原来的 ifstream + getline + substr + stringstream，每个网卡扫一遍文件
+//   reader: ProcNetDevReader 常驻 fd + pread + 单次遍历解析全部网卡
+// 同时统计每个周期的堆分配次数
+#include "collectors/proc_net_dev.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static std::atomic<uint64_t> g_allocs{0};
+
+void *operator new(size_t n)
+{
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+using namespace flow_scope;
+using Clock = std::chrono::steady_clock;
+
+static void write_synthetic(const std::string &path, int n)
+{
+    std::ofstream out(path);
+    out << "Inter-|   Receive                                                |  Transmit\n";
+    out << " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed\n";
+    for (int i = 0; i < n; ++i)
+    {
+        char line[512];
+        uint64_t base = 1000000007ULL * (i + 1);
+        snprintf(line, sizeof(line),
+                 "veth%08x: %llu %llu 0 3 0 0 0 12 %llu %llu 0 0 0 0 0 0\n", i,
+                 (unsigned long long)base, (unsigned long long)(base / 1000),
+                 (unsigned long long)(base * 3), (unsigned long long)(base / 700));
+        out << line;
+    }
+}
+
+// 原实现：每个网卡打开并扫描一遍文件
+static bool legacy_collect(const std::string &path, const std::string &name, uint64_t &rx, uint64_t &tx)
+{
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    std::getline(file, line);
+    while (std::getline(file, line))
+    {
+        size_t colon_pos = line.find(':');
+        if (colon_pos == std::string::npos)
+            continue;
+        std::string iface_name = line.substr(0, colon_pos);
+        iface_name.erase(0, iface_name.find_first_not_of(" "));
+        if (iface_name == name)
+        {
+            std::string stats = line.substr(colon_pos + 1);
+            std::stringstream ss(stats);
+            uint64_t temp = 0;
+            ss >> rx;
+            for (int i = 0; i < 7; ++i)
+                ss >> temp;
+            ss >> tx;
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    const int n_ifaces = argc > 1 ? std::atoi(argv[1]) : 5000;
+    const std::string path = "/tmp/flow_scope_bench_net_dev";
+    write_synthetic(path, n_ifaces);
+
+    std::vector<std::string> names;
+    for (int i = 0; i < n_ifaces; ++i)
+    {
+        char buf[IFNAMSIZ];
+        snprintf(buf, sizeof(buf), "veth%08x", i);
+        names.emplace_back(buf);
+    }
+
+    printf("interfaces: %d\n", n_ifaces);
+
+    // --- legacy：所有网卡一个周期 (O(n^2)，只跑一轮) ---
+    {
+        uint64_t checksum = 0;
+        uint64_t allocs0 = g_allocs.load();
+        auto t0 = Clock::now();
+        for (const auto &name : names)
+        {
+            uint64_t rx = 0, tx = 0;
+            legacy_collect(path, name, rx, tx);
+            checksum += rx + tx;
+        }
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        printf("legacy  : %10.3f ms/tick  %10llu allocs/tick  (checksum %llu)\n", ms,
+               (unsigned long long)(g_allocs.load() - allocs0), (unsigned long long)checksum);
+    }
+
+    // --- reader：读取 + 解析 + 按名查找全部网卡 ---
+    {
+        ProcNetDevReader reader(path);
+        std::vector<size_t> hints(names.size(), 0);
+        reader.read(); // 预热，让缓冲区扩容到稳态
+
+        const int iters = 200;
+        uint64_t checksum = 0;
+        uint64_t allocs0 = g_allocs.load();
+        auto t0 = Clock::now();
+        for (int it = 0; it < iters; ++it)
+        {
+            reader.read();
+            for (size_t i = 0; i < names.size(); ++i)
+            {
+                const LinkStats *link = reader.find(names[i], hints[i]);
+                if (link)
+                    checksum += link->cols[LinkStats::RX_BYTES] + link->cols[LinkStats::TX_BYTES];
+            }
+        }
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count() / iters;
+        printf("reader  : %10.3f ms/tick  %10.1f allocs/tick  (checksum %llu)\n", ms,
+               double(g_allocs.load() - allocs0) / iters, (unsigned long long)(checksum / iters));
+    }
+
+    // --- 仅解析 (内存中，不含系统调用) ---
+    {
+        std::ifstream in(path);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        std::string content = ss.str();
+
+        ProcNetDevReader reader(path);
+        reader.parse(content.data(), content.data() + content.size());
+
+        const int iters = 1000;
+        auto t0 = Clock::now();
+        for (int it = 0; it < iters; ++it)
+            reader.parse(content.data(), content.data() + content.size());
+        double us = std::chrono::duration<double, std::micro>(Clock::now() - t0).count() / iters;
+        printf("parse   : %10.3f us/tick  (%zu links, %.1f ns/link)\n", us, reader.count(),
+               us * 1000.0 / reader.count());
+    }
+
+    std::remove(path.c_str());
+    return 0;
+}
@@ -0,0 +1,158 @@
+// 共享内存快照读取吞吐测试
+// 一个写者线程向共享内存发布快照 (每一代所有字段都等于代号)，分两种节奏：不停地写 (最坏情况) 和 1Hz (实际情况)；
+// 多个读者线程用 ShmSnapshotReader 持续读取并校验是否读到撕裂的数据 (重试次数用完返回 Busy 的单独计数)。分别测试：
+//   read_all : 读取整份快照 (所有网卡)
+//   read_one : 按名字只读一个网卡 (负载均衡器的典型用法)
+// 用法: bench_shm_reader [读者线程数] [秒数] [网卡数]
+#include "core/shm_exporter.hpp"
+#include "core/shm_reader.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace flow_scope;
+
+enum class Outcome
+{
+    Ok,
+    Torn,
+    Busy,
+};
+
+static void fill(SystemSnapshot &s, uint64_t gen)
+{
+    s.generation = gen;
+    s.timestamp = gen;
+    s.tcp_retrans_total = gen;
+    for (auto &m : s.interfaces)
+    {
+        m.rtt_ms = static_cast<double>(gen);
+        m.packet_loss_rate = static_cast<double>(gen);
+        m.rx_bps = gen;
+        m.tx_bps = gen;
+        m.drops_total = gen;
+    }
+}
+
+static bool consistent(const ShmInterface &e, uint64_t gen)
+{
+    return e.rx_bps == gen && e.tx_bps == gen && e.drops_total == gen && e.rtt_ms == static_cast<double>(gen) &&
+           e.loss_rate == static_cast<double>(gen);
+}
+
+template <typename ReadFn>
+static void run(const char *label, const std::string &name, int readers, double seconds, size_t n_ifaces,
+                int writer_hz, ReadFn read_fn)
+{
+    ShmExporter exporter(name, static_cast<uint32_t>(n_ifaces));
+    if (!exporter.ok())
+        return;
+
+    SystemSnapshot snap;
+    snap.interfaces.resize(n_ifaces);
+    for (size_t i = 0; i < n_ifaces; ++i)
+    {
+        snap.interfaces[i].name = "veth" + std::to_string(i);
+        snap.interfaces[i].ifindex = static_cast<uint32_t>(i + 1);
+    }
+    fill(snap, 1);
+    exporter.publish(snap);
+
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> total_reads{0}, total_torn{0}, total_busy{0}, publishes{0};
+
+    std::thread writer([&]()
+                       {
+        uint64_t gen = 2;
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            fill(snap, gen++);
+            exporter.publish(snap);
+            if (writer_hz > 0)
+                std::this_thread::sleep_for(std::chrono::microseconds(1000000 / writer_hz));
+        }
+        publishes = gen - 2; });
+
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; ++r)
+    {
+        threads.emplace_back([&, r]()
+                             {
+            ShmSnapshotReader reader(name);
+            if (!reader.ok())
+            {
+                fprintf(stderr, "reader %d failed to map %s\n", r, name.c_str());
+                return;
+            }
+            uint64_t n = 0, torn = 0, busy = 0;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                Outcome o = read_fn(reader, r);
+                if (o == Outcome::Torn)
+                    ++torn;
+                else if (o == Outcome::Busy)
+                    ++busy;
+                ++n;
+            }
+            total_reads += n;
+            total_torn += torn;
+            total_busy += busy; });
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    writer.join();
+    for (auto &t : threads)
+        t.join();
+
+    printf("%-9s %-10s: %12.0f reads/s  %10.0f publishes/s  torn reads: %llu  busy: %llu\n", label,
+           writer_hz ? "writer 1Hz" : "writer max", total_reads / seconds, publishes / seconds,
+           (unsigned long long)total_torn.load(), (unsigned long long)total_busy.load());
+}
+
+int main(int argc, char **argv)
+{
+    int readers = argc > 1 ? std::atoi(argv[1]) : 4;
+    double seconds = argc > 2 ? std::atof(argv[2]) : 2.0;
+    size_t n_ifaces = argc > 3 ? static_cast<size_t>(std::atoi(argv[3])) : 256;
+    std::string name = "/flow_scope_bench_" + std::to_string(getpid());
+
+    printf("%d readers, %zu interfaces, %.1f s per run\n", readers, n_ifaces, seconds);
+
+    thread_local ShmSnapshot all;
+    auto read_all = [](const ShmSnapshotReader &reader, int)
+    {
+        ShmReadStatus st = reader.read(all);
+        if (st == ShmReadStatus::Busy)
+            return Outcome::Busy;
+        if (st != ShmReadStatus::Ok)
+            return Outcome::Torn;
+        for (const auto &e : all.interfaces)
+            if (!consistent(e, all.generation))
+                return Outcome::Torn;
+        return all.timestamp == all.generation ? Outcome::Ok : Outcome::Torn;
+    };
+
+    std::string target = "veth" + std::to_string(n_ifaces / 2);
+    auto read_one = [&target](const ShmSnapshotReader &reader, int)
+    {
+        ShmInterface e;
+        uint64_t gen = 0;
+        ShmReadStatus st = reader.read_interface(target.c_str(), e, &gen);
+        if (st == ShmReadStatus::Busy)
+            return Outcome::Busy;
+        return st == ShmReadStatus::Ok && consistent(e, gen) ? Outcome::Ok : Outcome::Torn;
+    };
+
+    for (int hz : {0, 1})
+    {
+        run("read_all", name, readers, seconds, n_ifaces, hz, read_all);
+        run("read_one", name, readers, seconds, n_ifaces, hz, read_one);
+    }
+
+    return 0;
+}
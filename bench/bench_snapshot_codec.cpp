@@ -0,0 +1,145 @@
+// 二进制快照编解码基准测试
+// 分别在 1 / 100 / 10000 个网卡的合成快照上，对比：
+//   json  : to_json 编码，nlohmann::json::parse 解码
+//   binary: SnapshotEncoder 编码 (编码器和输出缓冲区复用)，SnapshotDecoder 解码
+// 输出体积、每次编码/解码耗时，并校验二进制往返结果
+#include "core/snapshot_encoder.hpp"
+#include "core/snapshot_decoder.hpp"
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace flow_scope;
+using Clock = std::chrono::steady_clock;
+
+static const char *kReasons[] = {"NOT_SPECIFIED", "NO_SOCKET", "TCP_CSUM", "NETFILTER_DROP", "QDISC_DROP"};
+static const char *kStates[] = {"ESTABLISHED", "SYN_SENT", "CLOSE_WAIT"};
+
+static void build(SystemSnapshot &s, size_t n_ifaces)
+{
+    s.timestamp = 1700000000;
+    s.tcp_retrans_total = 123456789;
+    s.retrans_events_dropped = 42;
+
+    s.interfaces.resize(n_ifaces);
+    for (size_t i = 0; i < n_ifaces; ++i)
+    {
+        auto &m = s.interfaces[i];
+        char name[32];
+        snprintf(name, sizeof(name), "veth%06zu", i);
+        m.name = name;
+        m.ifindex = static_cast<uint32_t>(i + 2);
+        m.rtt_ms = 12.5 + i % 7;
+        m.packet_loss_rate = (i % 50 == 0) ? 1.0 : 0.0;
+        m.rx_bps = 1000000ULL * (i % 1000) + i;
+        m.tx_bps = 800000ULL * (i % 1000) + i;
+        m.tcp_retrans_total = i * 3;
+        m.tcp_rtt_p50_ms = 0.25 * (i % 11);
+        m.tcp_rtt_p90_ms = 0.5 * (i % 11);
+        m.tcp_rtt_p99_ms = 1.5 * (i % 11);
+        m.tcp_rtt_samples = 100 + i;
+        m.drops.clear();
+        for (size_t r = 0; r < i % 3; ++r)
+            m.drops.push_back({kReasons[(i + r) % 5], 10 * (r + 1)});
+        m.drops_total = 0;
+        for (const auto &d : m.drops)
+            m.drops_total += d.count;
+    }
+
+    s.top_flows.resize(10);
+    for (size_t i = 0; i < s.top_flows.size(); ++i)
+    {
+        auto &f = s.top_flows[i];
+        f.src = "10.0.0." + std::to_string(i + 1);
+        f.dst = "192.168.1.1";
+        f.sport = static_cast<uint16_t>(40000 + i);
+        f.dport = 443;
+        f.retrans = 10 - i;
+        f.retrans_total = 1000 - i;
+    }
+
+    s.retrans_events.resize(64);
+    for (size_t i = 0; i < s.retrans_events.size(); ++i)
+    {
+        auto &e = s.retrans_events[i];
+        e.ts_ns = 1700000000000000000ULL + i * 1000;
+        e.src = "10.0.0." + std::to_string(i % 10 + 1);
+        e.dst = "192.168.1.1";
+        e.sport = static_cast<uint16_t>(40000 + i % 10);
+        e.dport = 443;
+        e.ifindex = 2;
+        e.state = kStates[i % 3];
+    }
+}
+
+static bool same(const SystemSnapshot &a, const DecodedSnapshot &b)
+{
+    if (a.timestamp != b.timestamp || a.tcp_retrans_total != b.tcp_retrans_total ||
+        a.interfaces.size() != b.interfaces.size() || a.top_flows.size() != b.top_flows.size() ||
+        a.retrans_events.size() != b.retrans_events.size())
+        return false;
+    for (size_t i = 0; i < a.interfaces.size(); ++i)
+    {
+        const auto &x = a.interfaces[i];
+        const auto &y = b.interfaces[i];
+        if (x.name != y.name || x.ifindex != y.ifindex || x.rtt_ms != y.rtt_ms || x.rx_bps != y.rx_bps ||
+            x.tcp_rtt_p99_ms != y.tcp_rtt_p99_ms || x.drops.size() != y.drops.size())
+            return false;
+        for (size_t d = 0; d < x.drops.size(); ++d)
+            if (y.drops[d].reason != x.drops[d].reason || y.drops[d].count != x.drops[d].count)
+                return false;
+    }
+    for (size_t i = 0; i < a.retrans_events.size(); ++i)
+        if (a.retrans_events[i].src != b.retrans_events[i].src || b.retrans_events[i].state != a.retrans_events[i].state)
+            return false;
+    return true;
+}
+
+template <typename F>
+static double time_us(int iters, F &&f)
+{
+    auto t0 = Clock::now();
+    for (int i = 0; i < iters; ++i)
+        f();
+    return std::chrono::duration<double, std::micro>(Clock::now() - t0).count() / iters;
+}
+
+int main()
+{
+    printf("%8s  %-7s %12s %12s %12s\n", "ifaces", "format", "bytes", "encode us", "decode us");
+    for (size_t n : {size_t(1), size_t(100), size_t(10000)})
+    {
+        SystemSnapshot snap;
+        build(snap, n);
+        int iters = n >= 10000 ? 20 : 2000;
+
+        std::string json;
+        snap.to_json(json);
+        double json_enc = time_us(iters, [&]()
+                                  { snap.to_json(json); });
+        size_t sink = 0;
+        double json_dec = time_us(iters, [&]()
+                                  { sink += nlohmann::json::parse(json).size(); });
+
+        SnapshotEncoder encoder;
+        std::string bin;
+        encoder.encode(snap, bin);
+        double bin_enc = time_us(iters, [&]()
+                                 { encoder.encode(snap, bin); });
+        SnapshotDecoder decoder;
+        DecodedSnapshot decoded;
+        double bin_dec = time_us(iters, [&]()
+                                 { decoder.decode(bin.data(), bin.size(), decoded); });
+
+        bool ok = decoder.decode(bin.data(), bin.size(), decoded) && same(snap, decoded);
+
+        printf("%8zu  %-7s %12zu %12.2f %12.2f\n", n, "json", json.size(), json_enc, json_dec);
+        printf("%8zu  %-7s %12zu %12.2f %12.2f  (%.1fx smaller, roundtrip %s)\n", n, "binary", bin.size(), bin_enc,
+               bin_dec, double(json.size()) / bin.size(), ok ? "ok" : "MISMATCH");
+        if (sink == 0)
+            printf("unexpected empty parse\n");
+    }
+    return 0;
+}
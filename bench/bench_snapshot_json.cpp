@@ -0,0 +1,280 @@
+// SystemSnapshot JSON 序列化基准测试
+// 在数千个网卡的合成快照上对比：
+//   dom   : 原来的 nlohmann::json DOM + dump() (原样保留在本文件)
+//   stream: SystemSnapshot::to_json 流式写入复用的 std::string
+// 输出每次耗时和堆分配次数，并校验两者输出一致 (包括大量随机 double 的排版)：
+// 键、顺序、整数、字符串和 double 的排版规则都逐字节一致；double 的数字串来自 std::to_chars (真正最短)，
+// nlohmann 的 Grisu2 偶尔会多出或改动最后一位，这种情况只要求解析回来的值相同
+// 用法: bench_snapshot_json [网卡数]
+#include "core/metrics.hpp"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+
+static std::atomic<uint64_t> g_allocs{0};
+
+// 替换全局 operator new / delete 统计堆分配次数
+// 普通、数组、对齐、sized 各个版本都替换，所有分配路径计数一致，释放都回到对应的 free
+// 释放函数不内联：否则 GCC 在调用点看到 new 出来的指针直接交给 free，会报 -Wmismatched-new-delete
+static void *counted_alloc(size_t n, size_t align)
+{
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (n == 0)
+        n = 1;
+    void *p = align > alignof(std::max_align_t) ? std::aligned_alloc(align, (n + align - 1) / align * align)
+                                                : std::malloc(n);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+__attribute__((noinline)) static void counted_free(void *p) noexcept { std::free(p); }
+
+void *operator new(size_t n) { return counted_alloc(n, 0); }
+void *operator new[](size_t n) { return counted_alloc(n, 0); }
+void *operator new(size_t n, std::align_val_t a) { return counted_alloc(n, static_cast<size_t>(a)); }
+void *operator new[](size_t n, std::align_val_t a) { return counted_alloc(n, static_cast<size_t>(a)); }
+
+void operator delete(void *p) noexcept { counted_free(p); }
+void operator delete[](void *p) noexcept { counted_free(p); }
+void operator delete(void *p, size_t) noexcept { counted_free(p); }
+void operator delete[](void *p, size_t) noexcept { counted_free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { counted_free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { counted_free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { counted_free(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { counted_free(p); }
+
+using namespace flow_scope;
+using Clock = std::chrono::steady_clock;
+
+// 原来的实现
+static nlohmann::json legacy_to_json(const SystemSnapshot &s)
+{
+    nlohmann::json j;
+    j["system"] = "flow_scope";
+    j["timestamp"] = s.timestamp;
+    j["tcp_retrans_total"] = s.tcp_retrans_total;
+    j["interfaces"] = nlohmann::json::array();
+    for (const auto &iface : s.interfaces)
+    {
+        nlohmann::json drops = nlohmann::json::object();
+        for (const auto &d : iface.drops)
+            drops[d.reason] = d.count;
+
+        j["interfaces"].push_back({{"name", iface.name},
+                                   {"ifindex", iface.ifindex},
+                                   {"rtt_ms", iface.rtt_ms},
+                                   {"loss_rate", iface.packet_loss_rate},
+                                   {"loss_window", iface.packet_loss_window},
+                                   {"loss_samples", iface.packet_loss_samples},
+                                   {"rx_bps", iface.rx_bps},
+                                   {"tx_bps", iface.tx_bps},
+                                   {"tcp_retrans", iface.tcp_retrans_total},
+                                   {"tcp_rtt_p50_ms", iface.tcp_rtt_p50_ms},
+                                   {"tcp_rtt_p90_ms", iface.tcp_rtt_p90_ms},
+                                   {"tcp_rtt_p99_ms", iface.tcp_rtt_p99_ms},
+                                   {"tcp_rtt_samples", iface.tcp_rtt_samples},
+                                   {"drops_total", iface.drops_total},
+                                   {"drops", drops}});
+    }
+    j["top_flows"] = nlohmann::json::array();
+    for (const auto &flow : s.top_flows)
+    {
+        j["top_flows"].push_back({{"src", flow.src},
+                                  {"dst", flow.dst},
+                                  {"sport", flow.sport},
+                                  {"dport", flow.dport},
+                                  {"retrans", flow.retrans},
+                                  {"retrans_total", flow.retrans_total}});
+    }
+    j["retrans_events"] = nlohmann::json::array();
+    for (const auto &ev : s.retrans_events)
+    {
+        j["retrans_events"].push_back({{"ts_ns", ev.ts_ns},
+                                       {"src", ev.src},
+                                       {"dst", ev.dst},
+                                       {"sport", ev.sport},
+                                       {"dport", ev.dport},
+                                       {"ifindex", ev.ifindex},
+                                       {"state", ev.state}});
+    }
+    j["retrans_events_dropped"] = s.retrans_events_dropped;
+    j["drop_untracked_interfaces"] = s.drop_untracked_interfaces;
+    j["rtt_targets"] = nlohmann::json::array();
+    for (const auto &t : s.rtt_targets)
+    {
+        j["rtt_targets"].push_back({{"target", t.target},
+                                    {"rtt_ms", t.rtt_ms},
+                                    {"rtt_min_ms", t.rtt_min_ms},
+                                    {"rtt_avg_ms", t.rtt_avg_ms},
+                                    {"rtt_max_ms", t.rtt_max_ms},
+                                    {"jitter_ms", t.jitter_ms},
+                                    {"loss_rate", t.loss_rate},
+                                    {"loss_window", t.loss_window},
+                                    {"loss_samples", t.loss_samples},
+                                    {"sent", t.sent},
+                                    {"received", t.received},
+                                    {"rtt_user_ms", t.rtt_user_ms},
+                                    {"rtt_user_avg_ms", t.rtt_user_avg_ms}});
+    }
+    return j;
+}
+
+static const char *kReasons[] = {"NOT_SPECIFIED", "NO_SOCKET", "TCP_CSUM", "NETFILTER_DROP", "QDISC_DROP"};
+
+// 随机 double：覆盖定点、小数、科学计数法、整数值和 0 等各种排版分支
+static double random_double(std::mt19937_64 &rng)
+{
+    switch (rng() % 6)
+    {
+    case 0:
+        return 0.0;
+    case 1:
+        return static_cast<double>(rng() % 100000); // 整数值
+    case 2:
+        return std::uniform_real_distribution<double>(0, 1000)(rng);
+    case 3:
+        return std::uniform_real_distribution<double>(0, 1e-3)(rng);
+    case 4:
+    {
+        uint64_t bits = rng();
+        double d;
+        std::memcpy(&d, &bits, sizeof(d)); // 任意位模式 (包括 NaN / Inf / 极大极小值)
+        return d;
+    }
+    default:
+        return std::ldexp(1.0, static_cast<int>(rng() % 200) - 100);
+    }
+}
+
+static void build(SystemSnapshot &s, size_t n, std::mt19937_64 &rng)
+{
+    s.timestamp = 1700000000;
+    s.tcp_retrans_total = rng();
+    s.retrans_events_dropped = rng() % 1000;
+    s.drop_untracked_interfaces = static_cast<uint32_t>(rng() % 100);
+    s.interfaces.resize(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        auto &m = s.interfaces[i];
+        m.name = "veth" + std::to_string(i);
+        m.ifindex = static_cast<uint32_t>(i + 2);
+        m.rtt_ms = random_double(rng);
+        m.packet_loss_rate = random_double(rng);
+        m.packet_loss_window = static_cast<uint32_t>(rng() % 65536);
+        m.packet_loss_samples = static_cast<uint32_t>(rng() % 65536);
+        m.rx_bps = rng() >> (rng() % 64);
+        m.tx_bps = rng() >> (rng() % 64);
+        m.tcp_retrans_total = rng() % 100000;
+        m.tcp_rtt_p50_ms = random_double(rng);
+        m.tcp_rtt_p90_ms = random_double(rng);
+        m.tcp_rtt_p99_ms = random_double(rng);
+        m.tcp_rtt_samples = rng() % 10000;
+        m.drops.clear();
+        m.drops_total = 0;
+        for (size_t r = 0; r < rng() % 4; ++r)
+        {
+            m.drops.push_back({kReasons[(i + r) % 5], rng() % 1000});
+            m.drops_total += m.drops.back().count;
+        }
+    }
+    s.top_flows.resize(10);
+    for (size_t i = 0; i < s.top_flows.size(); ++i)
+    {
+        auto &f = s.top_flows[i];
+        f.src = "2001:db8::" + std::to_string(i);
+        f.dst = "10.0.0.1";
+        f.sport = static_cast<uint16_t>(rng());
+        f.dport = 443;
+        f.retrans = rng() % 100;
+        f.retrans_total = rng() % 100000;
+    }
+    s.retrans_events.resize(64);
+    for (size_t i = 0; i < s.retrans_events.size(); ++i)
+    {
+        auto &e = s.retrans_events[i];
+        e.ts_ns = rng();
+        e.src = "10.0.0." + std::to_string(i);
+        e.dst = "10.0.1.1";
+        e.sport = static_cast<uint16_t>(rng());
+        e.dport = 80;
+        e.ifindex = 2;
+        e.state = "ESTABLISHED";
+    }
+    s.rtt_targets.resize(8);
+    for (size_t i = 0; i < s.rtt_targets.size(); ++i)
+    {
+        auto &t = s.rtt_targets[i];
+        t.target = "192.0.2." + std::to_string(i + 1);
+        t.rtt_ms = random_double(rng);
+        t.rtt_min_ms = random_double(rng);
+        t.rtt_avg_ms = random_double(rng);
+        t.rtt_max_ms = random_double(rng);
+        t.jitter_ms = random_double(rng);
+        t.loss_rate = random_double(rng);
+        t.loss_window = static_cast<uint32_t>(rng() % 65536);
+        t.loss_samples = static_cast<uint32_t>(rng() % 65536);
+        t.sent = rng() % 100000;
+        t.received = rng() % 100000;
+        t.rtt_user_ms = random_double(rng);
+        t.rtt_user_avg_ms = random_double(rng);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 5000;
+    std::mt19937_64 rng(42);
+
+    // 1. 一致性 (多轮随机数据)
+    int identical = 0, equal_values = 0;
+    const int rounds = 50;
+    std::string out;
+    for (int round = 0; round < rounds; ++round)
+    {
+        SystemSnapshot s;
+        build(s, 200, rng);
+        s.to_json(out);
+        std::string expected = legacy_to_json(s).dump();
+        if (out == expected)
+            ++identical;
+        if (nlohmann::json::parse(out) == nlohmann::json::parse(expected))
+            ++equal_values;
+    }
+    printf("compat : %d / %d rounds byte-identical, %d / %d parse to identical values\n", identical, rounds,
+           equal_values, rounds);
+
+    // 2. 耗时与分配
+    SystemSnapshot snap;
+    build(snap, n, rng);
+    const int iters = 20;
+
+    {
+        size_t bytes = 0;
+        uint64_t a0 = g_allocs.load();
+        auto t0 = Clock::now();
+        for (int i = 0; i < iters; ++i)
+            bytes = legacy_to_json(snap).dump().size();
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count() / iters;
+        printf("dom    : %8.3f ms  %10.1f allocs  (%zu interfaces, %zu bytes)\n", ms,
+               double(g_allocs.load() - a0) / iters, n, bytes);
+    }
+    {
+        snap.to_json(out); // 预热，让缓冲区扩容到稳态
+        uint64_t a0 = g_allocs.load();
+        auto t0 = Clock::now();
+        for (int i = 0; i < iters; ++i)
+            snap.to_json(out);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count() / iters;
+        printf("stream : %8.3f ms  %10.1f allocs  (%zu interfaces, %zu bytes)\n", ms,
+               double(g_allocs.load() - a0) / iters, n, out.size());
+    }
+    return 0;
+}
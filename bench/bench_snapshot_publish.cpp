@@ -0,0 +1,152 @@
+// 快照发布压力测试
+// 一个写者线程不停地写入并发布快照 (每一代所有字段都等于代号)，多个读者线程模拟 /metrics 并发读取，
+// 每次读取都校验整份快照是否属于同一代，统计读者吞吐和撕裂读 (torn read) 次数。对比：
+//   legacy : 原来的 shared_ptr + atomic_load/atomic_exchange 双缓冲 (旧前台立即被回收改写)
+//   manager: Manager 三缓冲 + 读者计数
+// 用法: bench_snapshot_publish [读者线程数] [秒数] [网卡数]
+#include "core/manager.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace flow_scope;
+
+// 原来的发布方式，原样保留用于对比
+class LegacyManager
+{
+public:
+    LegacyManager()
+    {
+        std::atomic_store(&active_, std::make_shared<SystemSnapshot>());
+        background_ = std::make_shared<SystemSnapshot>();
+    }
+
+    std::shared_ptr<const SystemSnapshot> get_snapshot() const { return std::atomic_load(&active_); }
+    SystemSnapshot *get_background_buffer() { return background_.get(); }
+
+    void publish_snapshot()
+    {
+        std::shared_ptr<SystemSnapshot> new_active = background_;
+        background_ = std::atomic_exchange(&active_, new_active);
+        background_->reset();
+    }
+
+private:
+    std::shared_ptr<SystemSnapshot> active_;
+    std::shared_ptr<SystemSnapshot> background_;
+};
+
+// 写入一整代：时间戳、每个网卡的所有数值字段都等于 gen
+static void fill(SystemSnapshot &s, uint64_t gen, size_t n_ifaces)
+{
+    s.interfaces.resize(n_ifaces);
+    for (size_t i = 0; i < n_ifaces; ++i)
+    {
+        auto &m = s.interfaces[i];
+        m.ifindex = static_cast<uint32_t>(i + 1);
+        m.rx_bps = gen;
+        m.tx_bps = gen;
+        m.tcp_retrans_total = gen;
+        m.drops_total = gen;
+    }
+    s.tcp_retrans_total = gen;
+    s.timestamp = gen;
+}
+
+// 快照是否属于同一代
+static bool consistent(const SystemSnapshot &s, size_t n_ifaces)
+{
+    uint64_t gen = s.timestamp;
+    if (gen == 0)
+        return true; // 初始的空快照
+    if (s.interfaces.size() != n_ifaces || s.tcp_retrans_total != gen)
+        return false;
+    for (const auto &m : s.interfaces)
+    {
+        if (m.rx_bps != gen || m.tx_bps != gen || m.tcp_retrans_total != gen || m.drops_total != gen)
+            return false;
+    }
+    return true;
+}
+
+struct Result
+{
+    uint64_t reads = 0;
+    uint64_t torn = 0;
+    uint64_t publishes = 0;
+};
+
+template <typename Mgr>
+static Result run(Mgr &mgr, int readers, double seconds, size_t n_ifaces)
+{
+    std::atomic<bool> stop{false};
+    std::vector<uint64_t> reads(readers * 8, 0); // 每个线程间隔 64 字节
+    std::vector<uint64_t> torn(readers * 8, 0);
+    Result res;
+
+    std::thread writer([&]()
+                       {
+        uint64_t gen = 1;
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            fill(*mgr.get_background_buffer(), gen++, n_ifaces);
+            mgr.publish_snapshot();
+        }
+        res.publishes = gen - 1; });
+
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; ++r)
+    {
+        threads.emplace_back([&, r]()
+                             {
+            uint64_t n = 0, bad = 0;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                auto snap = mgr.get_snapshot();
+                if (!consistent(*snap, n_ifaces))
+                    ++bad;
+                ++n;
+            }
+            reads[r * 8] = n;
+            torn[r * 8] = bad; });
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop.store(true);
+    writer.join();
+    for (auto &t : threads)
+        t.join();
+
+    for (int r = 0; r < readers; ++r)
+    {
+        res.reads += reads[r * 8];
+        res.torn += torn[r * 8];
+    }
+    return res;
+}
+
+static void report(const char *name, const Result &res, double seconds)
+{
+    printf("%-8s: %12.0f reads/s  %10.0f publishes/s  torn reads: %llu\n", name, res.reads / seconds,
+           res.publishes / seconds, (unsigned long long)res.torn);
+}
+
+int main(int argc, char **argv)
+{
+    int readers = argc > 1 ? std::atoi(argv[1]) : 8;
+    double seconds = argc > 2 ? std::atof(argv[2]) : 3.0;
+    size_t n_ifaces = argc > 3 ? static_cast<size_t>(std::atoi(argv[3])) : 64;
+
+    printf("%d readers, %zu interfaces, %.1f s per run\n", readers, n_ifaces, seconds);
+
+    LegacyManager legacy;
+    report("legacy", run(legacy, readers, seconds, n_ifaces), seconds);
+
+    report("manager", run(Manager::get_instance(), readers, seconds, n_ifaces), seconds);
+    return 0;
+}
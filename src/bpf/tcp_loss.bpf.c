@@ -2,44 +2,260 @@
 #include <bpf/bpf_helpers.h>
 #include <bpf/bpf_tracing.h>
 #include <bpf/bpf_core_read.h>
+#include "tcp_loss.h"
 
 // 定义许可协议 (必须是 GPL，否则内核拒绝加载)
 char LICENSE[] SEC("license") = "GPL";
 
 // --- 定义 Map (用于和用户态共享数据) ---
-// 使用 Array Map，Key=0 的位置存储总重传数
+// 使用 Per-CPU Array Map，Key=COUNTER_RETRANS 的位置存储总重传数 (其余槽位见 tcp_loss.h)
+// 每个 CPU 拥有独立的计数槽，重传风暴时各核之间不会争抢同一条 Cache Line，
+// 用户态读取时把所有 CPU 的值求和即可
 struct
 {
-    __uint(type, BPF_MAP_TYPE_ARRAY);
-    __uint(max_entries, 1);
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, COUNTER_MAX);
     __type(key, u32);
     __type(value, u64);
 } tcp_retrans_counter SEC(".maps");
 
+// 每网卡重传计数: Key=ifindex, Value=重传次数 (每个 CPU 一份)
+// 使用 LRU 版本，容器主机上 veth 频繁增删，旧 ifindex 会被自动淘汰
+struct
+{
+    __uint(type, BPF_MAP_TYPE_LRU_PERCPU_HASH);
+    __uint(max_entries, IFINDEX_MAP_MAX_ENTRIES);
+    __type(key, u32);
+    __type(value, u64);
+} tcp_retrans_by_ifindex SEC(".maps");
+
+// 每流重传表: Key=TCP 四元组, Value=重传次数
+// LRU Hash 保证表有界：流量再多也只占 FLOW_MAP_MAX_ENTRIES 个条目，满了自动淘汰最旧的
+// 用户态每个 tick 用 lookup_and_delete_batch 抽干，所以表里只剩"上次抽取后有变化"的流
+struct
+{
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, FLOW_MAP_MAX_ENTRIES);
+    __type(key, struct flow_key);
+    __type(value, struct flow_stats);
+} tcp_flow_retrans SEC(".maps");
+
+// 重传事件流: 每次重传一条 retrans_event，用户态通过 epoll 实时消费
+struct
+{
+    __uint(type, BPF_MAP_TYPE_RINGBUF);
+    __uint(max_entries, RETRANS_RINGBUF_BYTES);
+} retrans_events SEC(".maps");
+
+// 每网卡 TCP 平滑 RTT 直方图: Key=ifindex, Value=log2 直方图 (每个 CPU 一份)
+struct
+{
+    __uint(type, BPF_MAP_TYPE_LRU_PERCPU_HASH);
+    __uint(max_entries, RTT_HIST_MAX_ENTRIES);
+    __type(key, u32);
+    __type(value, struct rtt_hist);
+} tcp_rtt_hist SEC(".maps");
+
+// 丢包计数: 下标为网卡槽位，值为按 reason 展开的计数 (每个 CPU 一份)
+// 每次丢包只是一次 Per-CPU Array 访问 + 本地递增，百万 pps 的丢包也不会产生跨核争用
+struct
+{
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, DROP_IF_SLOTS);
+    __type(key, u32);
+    __type(value, struct drop_counts);
+} drop_counters SEC(".maps");
+
+// ifindex -> drop_counters 槽位
+// 只由用户态在发现新网卡时写入，BPF 侧只读，热路径上没有共享 Hash 的更新
+struct
+{
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, DROP_IF_SLOTS);
+    __type(key, u32);
+    __type(value, u32);
+} drop_if_slot SEC(".maps");
+
+static __always_inline void count(u32 key)
+{
+    u64 *val = bpf_map_lookup_elem(&tcp_retrans_counter, &key);
+    if (val)
+        *val += 1;
+}
+
 // --- 定义 Tracepoint Hook ---
 // Hook 点: /sys/kernel/debug/tracing/events/tcp/tcp_retransmit_skb
 // 当内核函数 tcp_retransmit_skb 执行时，触发此代码
 SEC("tracepoint/tcp/tcp_retransmit_skb")
-int handle_tcp_retransmit(void *ctx)
+int handle_tcp_retransmit(struct trace_event_raw_tcp_event_sk_skb *ctx)
 {
 
-    // 1. 获取 Map 的 Key (0)
-    u32 key = 0;
-    u64 *val;
+    // 1. 全局计数
+    // 槽位只属于当前 CPU，且 BPF 程序执行期间不会被迁移，无需原子操作
+    count(COUNTER_RETRANS);
+
+    // 2. 归属到网卡
+    // 优先用 skb 的出口设备；重传时 skb 往往还没挂上 dev，
+    // 再依次退回到 socket 绑定的设备 (SO_BINDTODEVICE) 和 socket 缓存的路由出口
+    struct sk_buff *skb = (struct sk_buff *)ctx->skbaddr;
+    struct sock *sk = (struct sock *)ctx->skaddr;
+    u32 ifindex = BPF_CORE_READ(skb, dev, ifindex);
+    if (!ifindex)
+        ifindex = BPF_CORE_READ(sk, __sk_common.skc_bound_dev_if);
+    if (!ifindex)
+        ifindex = BPF_CORE_READ(sk, sk_dst_cache, dev, ifindex);
+
+    if (ifindex)
+    {
+        u64 *ifval = bpf_map_lookup_elem(&tcp_retrans_by_ifindex, &ifindex);
+        if (ifval)
+        {
+            *ifval += 1;
+        }
+        else
+        {
+            u64 one = 1;
+            bpf_map_update_elem(&tcp_retrans_by_ifindex, &ifindex, &one, BPF_NOEXIST);
+        }
+    }
+
+    // 3. 按四元组记录每流重传
+    // tracepoint 对 IPv4 也会填充 v4-mapped 的 saddr_v6/daddr_v6，直接拷贝即可
+    struct flow_key fkey = {};
+    __builtin_memcpy(fkey.saddr, ctx->saddr_v6, sizeof(fkey.saddr));
+    __builtin_memcpy(fkey.daddr, ctx->daddr_v6, sizeof(fkey.daddr));
+    fkey.sport = ctx->sport;
+    fkey.dport = ctx->dport;
+    fkey.family = ctx->family;
+
+    u64 now = bpf_ktime_get_ns();
+    struct flow_stats *fstats = bpf_map_lookup_elem(&tcp_flow_retrans, &fkey);
+    if (fstats)
+    {
+        // 同一条流可能同时在多个 CPU 上重传，这里需要原子操作
+        __sync_fetch_and_add(&fstats->retrans, 1);
+        fstats->last_ns = now;
+    }
+    else
+    {
+        // 首次出现：插入新条目 (并发插入失败时最多少记一次，可以接受)
+        struct flow_stats init = {.retrans = 1, .last_ns = now};
+        bpf_map_update_elem(&tcp_flow_retrans, &fkey, &init, BPF_NOEXIST);
+    }
 
-    // 2. 查找 Map 中的值
-    val = bpf_map_lookup_elem(&tcp_retrans_counter, &key);
-    if (!val)
+    // 4. 推送事件
+    struct retrans_event *e = bpf_ringbuf_reserve(&retrans_events, sizeof(*e), 0);
+    if (!e)
     {
-        return 0; // 理论上不会发生
+        // Ring Buffer 满了 (用户态来不及消费)，记录丢弃数
+        count(COUNTER_EVENT_DROPS);
+        return 0;
     }
+    e->ts_ns = now;
+    e->flow = fkey;
+    e->ifindex = ifindex;
+    e->state = ctx->state;
 
-    // 3. 原子递增计数器
-    // __sync_fetch_and_add 是 BPF 允许的原子操作
-    __sync_fetch_and_add(val, 1);
+    // 批量唤醒：默认不唤醒用户态，只有积压超过阈值才强制唤醒一次
+    // 低于阈值的事件由用户态的定时器兜底消费，重传风暴不会变成 epoll 唤醒风暴
+    u64 flags = BPF_RB_NO_WAKEUP;
+    if (bpf_ringbuf_query(&retrans_events, BPF_RB_AVAIL_DATA) >= RETRANS_WAKEUP_BYTES)
+        flags = BPF_RB_FORCE_WAKEUP;
+    bpf_ringbuf_submit(e, flags);
 
     // 调试打印 (可以通过 sudo cat /sys/kernel/debug/tracing/trace_pipe 查看)
     // bpf_printk("FlowScope: TCP Retransmit detected!\n");
 
     return 0;
-}
\ No newline at end of file
+}
+
+// 无分支的 floor(log2(v))
+static __always_inline u32 log2_u32(u32 v)
+{
+    u32 shift, r;
+
+    r = (v > 0xFFFF) << 4;
+    v >>= r;
+    shift = (v > 0xFF) << 3;
+    v >>= shift;
+    r |= shift;
+    shift = (v > 0xF) << 2;
+    v >>= shift;
+    r |= shift;
+    shift = (v > 0x3) << 1;
+    v >>= shift;
+    r |= shift;
+    r |= (v >> 1);
+    return r;
+}
+
+// --- 定义 fentry Hook ---
+// Hook 点: tcp_rcv_established (已建立连接的收包/ACK 快路径)
+// 直接读取内核维护的平滑 RTT (tcp_sock::srtt_us)，不需要发送任何探测包
+// fentry 经由 BPF trampoline 调用，开销远小于 kprobe
+SEC("fentry/tcp_rcv_established")
+int BPF_PROG(handle_tcp_rcv, struct sock *sk, struct sk_buff *skb)
+{
+    struct tcp_sock *tp = (struct tcp_sock *)sk;
+
+    // srtt_us 存的是 8 倍的平滑 RTT (微秒)
+    u32 srtt_us = tp->srtt_us >> 3;
+    if (!srtt_us)
+        return 0; // 还没有 RTT 样本
+
+    // 收包网卡
+    u32 ifindex = skb->skb_iif;
+
+    struct rtt_hist *hist = bpf_map_lookup_elem(&tcp_rtt_hist, &ifindex);
+    if (!hist)
+    {
+        // 首次出现：插入全零直方图后再取 (只写当前 CPU 的副本)
+        static const struct rtt_hist zero = {};
+        bpf_map_update_elem(&tcp_rtt_hist, &ifindex, &zero, BPF_NOEXIST);
+        hist = bpf_map_lookup_elem(&tcp_rtt_hist, &ifindex);
+        if (!hist)
+            return 0;
+    }
+
+    u32 slot = log2_u32(srtt_us);
+    if (slot >= RTT_SLOTS)
+        slot = RTT_SLOTS - 1;
+
+    // 当前 CPU 的副本，无需原子操作
+    hist->slots[slot] += 1;
+    return 0;
+}
+
+// --- 定义 Tracepoint Hook ---
+// Hook 点: skb:kfree_skb (内核丢弃一个 skb 时触发，reason 字段需要 5.17+ 内核)
+SEC("tracepoint/skb/kfree_skb")
+int handle_kfree_skb(struct trace_event_raw_kfree_skb *ctx)
+{
+    u32 reason = ctx->reason;
+
+    // 正常释放 (不是丢包) 的 skb 不统计
+    if (reason == SKB_NOT_DROPPED_YET || reason == SKB_CONSUMED)
+        return 0;
+
+    // 丢包所在网卡：优先 skb 当前的 dev，其次收包网卡
+    struct sk_buff *skb = (struct sk_buff *)ctx->skbaddr;
+    u32 ifindex = BPF_CORE_READ(skb, dev, ifindex);
+    if (!ifindex)
+        ifindex = BPF_CORE_READ(skb, skb_iif);
+
+    // 只统计用户态登记过的网卡
+    u32 *slot = bpf_map_lookup_elem(&drop_if_slot, &ifindex);
+    if (!slot)
+        return 0;
+
+    struct drop_counts *counts = bpf_map_lookup_elem(&drop_counters, slot);
+    if (!counts)
+        return 0;
+
+    if (reason >= DROP_REASON_SLOTS)
+        reason = DROP_REASON_SLOTS - 1;
+
+    // 当前 CPU 的副本，无需原子操作
+    counts->reasons[reason] += 1;
+    return 0;
+}
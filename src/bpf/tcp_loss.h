@@ -0,0 +1,85 @@
+// 内核态 (tcp_loss.bpf.c) 与用户态 (collectors/*.hpp) 共享的数据结构
+// 两边必须保持完全一致的内存布局
+#ifndef FLOW_SCOPE_TCP_LOSS_H
+#define FLOW_SCOPE_TCP_LOSS_H
+
+#ifndef __VMLINUX_H__
+#include <linux/types.h>
+#endif
+
+// tcp_retrans_counter (Per-CPU Array) 的槽位
+enum
+{
+    COUNTER_RETRANS = 0,     // 全局重传总数
+    COUNTER_EVENT_DROPS = 1, // Ring Buffer 已满被丢弃的事件数
+    COUNTER_MAX,
+};
+
+// 每网卡计数表的最大条目数 (LRU 淘汰)
+#define IFINDEX_MAP_MAX_ENTRIES 4096
+
+// 每流重传表的最大条目数 (LRU 淘汰)，用户态每个 tick 会把表抽干
+#define FLOW_MAP_MAX_ENTRIES 65536
+
+// TCP 四元组
+// 地址统一使用 16 字节形式：IPv4 由 tracepoint 填成 v4-mapped (::ffff:a.b.c.d)
+struct flow_key
+{
+    __u8 saddr[16];
+    __u8 daddr[16];
+    __u16 sport; // 主机字节序
+    __u16 dport; // 主机字节序
+    __u16 family;
+    __u16 pad;
+};
+
+struct flow_stats
+{
+    __u64 retrans;
+    __u64 last_ns; // 最近一次重传的 bpf_ktime_get_ns()
+};
+
+// 重传事件 Ring Buffer 大小 (必须是页大小的 2 的幂倍)
+#define RETRANS_RINGBUF_BYTES (256 * 1024)
+
+// 积压超过这么多字节才唤醒用户态 (约 64 个事件)
+#define RETRANS_WAKEUP_BYTES (64 * 64)
+
+// Ring Buffer 中的单个重传事件
+struct retrans_event
+{
+    __u64 ts_ns; // bpf_ktime_get_ns() (CLOCK_MONOTONIC)
+    struct flow_key flow;
+    __u32 ifindex; // 0 表示无法归属
+    __u32 state;   // TCP 状态 (TCP_ESTABLISHED 等)
+};
+
+// TCP 平滑 RTT 的 log2 直方图
+// 第 i 个槽位统计 srtt 落在 [2^i, 2^(i+1)) 微秒的样本，最后一个槽位兜底 (>= 2^23us ≈ 8.4s)
+#define RTT_SLOTS 24
+
+// 每网卡 RTT 直方图表的最大条目数 (LRU 淘汰)
+// Per-CPU 值会为每个 CPU 预分配一份，条目数不宜过大
+#define RTT_HIST_MAX_ENTRIES 512
+
+struct rtt_hist
+{
+    __u64 slots[RTT_SLOTS];
+};
+
+// 丢包原因计数 (skb:kfree_skb 的 reason 字段，即内核 enum skb_drop_reason)
+// reason 超出范围的计入最后一个槽位
+#define DROP_REASON_SLOTS 128
+
+// 丢包统计最多同时跟踪的网卡数 (默认值)
+// 用户态在加载前按配置改写 drop_counters / drop_if_slot 的 max_entries (--drop-slots)，
+// 每个槽位在每个 CPU 上占 sizeof(drop_counts) = 1KB
+// ifindex -> 槽位的映射由用户态维护 (drop_if_slot)，BPF 侧只读；网卡被移除后槽位回收复用
+#define DROP_IF_SLOTS 256
+
+struct drop_counts
+{
+    __u64 reasons[DROP_REASON_SLOTS];
+};
+
+#endif // FLOW_SCOPE_TCP_LOSS_H
@@ -0,0 +1,122 @@
+#pragma once
+#include <bpf/libbpf.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+#include "../bpf/tcp_loss.h"
+
+// 包含自动生成的骨架头文件
+#include "tcp_loss.skel.h"
+
+namespace flow_scope
+{
+
+    // tcp_loss.bpf.c 编译出的 BPF 对象
+    // 所有基于 eBPF 的采集器共享同一个 Skeleton，只加载/挂载一次
+    class BpfObject
+    {
+    public:
+        // drop_counters 是预分配的 Per-CPU Array，每个槽位每 CPU 1KB，槽位数不能无限制放大
+        static constexpr uint32_t kMaxDropIfSlots = 65536;
+
+        // drop_if_slots: 丢包统计最多同时跟踪的网卡数 (1 ~ kMaxDropIfSlots)，加载前写入对应 Map 的 max_entries
+        explicit BpfObject(uint32_t drop_if_slots = DROP_IF_SLOTS)
+            : drop_if_slots_(std::min(std::max<uint32_t>(drop_if_slots, 1), kMaxDropIfSlots))
+        {
+            // 1. 调整 RLIMIT_MEMLOCK
+            // eBPF Map 需要锁定内存，默认限制通常太小，必须调大
+            struct rlimit rlim = {RLIM_INFINITY, RLIM_INFINITY};
+            if (setrlimit(RLIMIT_MEMLOCK, &rlim))
+            {
+                perror("setrlimit(RLIMIT_MEMLOCK) failed");
+            }
+
+            // 2. 打开、加载、挂载
+            // 两个可选程序依赖不同的内核特性 (handle_tcp_rcv 要 fentry/BTF trampoline，
+            // handle_kfree_skb 要 kfree_skb 的 reason 字段)，加载失败时逐个关掉再试，
+            // 一个不支持不会连累另一个，最基础的重传统计在老内核上仍然可用
+            if (!open_and_attach(true, true) && !open_and_attach(true, false) && !open_and_attach(false, true) &&
+                !open_and_attach(false, false))
+                return;
+
+            // 3. Per-CPU Map 的 lookup 会一次性返回所有 possible CPU 的值
+            ncpus_ = libbpf_num_possible_cpus();
+            if (ncpus_ <= 0)
+            {
+                std::cerr << "Failed to get possible CPU count" << std::endl;
+                ncpus_ = 1;
+            }
+
+            std::cout << "--> eBPF programs attached successfully!" << std::endl;
+        }
+
+        ~BpfObject()
+        {
+            if (skel_)
+            {
+                tcp_loss_bpf__destroy(skel_);
+            }
+        }
+
+        BpfObject(const BpfObject &) = delete;
+        BpfObject &operator=(const BpfObject &) = delete;
+
+        // 加载失败时返回 nullptr，采集器需自行降级
+        struct tcp_loss_bpf *skel() const { return skel_; }
+
+        // possible CPU 数量，用于分配 Per-CPU Map 的读取缓冲区
+        int ncpus() const { return ncpus_; }
+
+        // 可选程序是否真正挂载成功 (TcpRttMonitor / DropMonitor 各自检查)
+        bool tcp_rcv_loaded() const { return tcp_rcv_loaded_; }
+        bool kfree_skb_loaded() const { return kfree_skb_loaded_; }
+
+        // drop_counters 的槽位数
+        uint32_t drop_if_slots() const { return drop_if_slots_; }
+
+    private:
+        struct tcp_loss_bpf *skel_ = nullptr;
+        int ncpus_ = 1;
+        uint32_t drop_if_slots_;
+        bool tcp_rcv_loaded_ = false;
+        bool kfree_skb_loaded_ = false;
+
+        bool open_and_attach(bool tcp_rcv, bool kfree_skb)
+        {
+            // 打开 Skeleton (Open)
+            skel_ = tcp_loss_bpf__open();
+            if (!skel_)
+            {
+                std::cerr << "Failed to open BPF skeleton" << std::endl;
+                return false;
+            }
+
+            // 丢包统计的槽位数在加载前按配置调整；不加载 handle_kfree_skb 时这两个 Map 也不创建，
+            // 否则 Map 创建失败 (如内存不足) 会让每一级回退都失败，连带重传和 RTT 统计一起丢掉
+            bpf_map__set_max_entries(skel_->maps.drop_counters, drop_if_slots_);
+            bpf_map__set_max_entries(skel_->maps.drop_if_slot, drop_if_slots_);
+            bpf_map__set_autocreate(skel_->maps.drop_counters, kfree_skb);
+            bpf_map__set_autocreate(skel_->maps.drop_if_slot, kfree_skb);
+
+            bpf_program__set_autoload(skel_->progs.handle_tcp_rcv, tcp_rcv);
+            bpf_program__set_autoload(skel_->progs.handle_kfree_skb, kfree_skb);
+
+            // 加载并验证 (Load)，挂载到内核 (Attach)
+            if (tcp_loss_bpf__load(skel_) || tcp_loss_bpf__attach(skel_))
+            {
+                std::cerr << "Failed to load/attach BPF skeleton (tcp_rcv " << (tcp_rcv ? "on" : "off")
+                          << ", kfree_skb " << (kfree_skb ? "on" : "off") << ")" << std::endl;
+                tcp_loss_bpf__destroy(skel_);
+                skel_ = nullptr;
+                return false;
+            }
+
+            tcp_rcv_loaded_ = tcp_rcv;
+            kfree_skb_loaded_ = kfree_skb;
+            return true;
+        }
+    };
+
+} // namespace flow_scope
@@ -0,0 +1,189 @@
+#pragma once
+#include "monitor_base.hpp"
+#include "bpf_object.hpp"
+#include <bpf/bpf.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace flow_scope
+{
+
+    // 内核丢包监控：按网卡、按丢包原因 (skb_drop_reason) 统计 kfree_skb
+    // 每个网卡占 drop_counters 的一个槽位 (数量由 --drop-slots 决定)，槽位用完后新网卡的丢包不统计，
+    // 这类网卡的个数作为 drop_untracked_interfaces 导出；网卡被移除时槽位回收
+    class DropMonitor : public MonitorBase
+    {
+    public:
+        explicit DropMonitor(BpfObject &bpf) : skel_(bpf.skel()), max_slots_(bpf.drop_if_slots())
+        {
+            if (!skel_ || !bpf.kfree_skb_loaded())
+            {
+                // 内核不支持 kfree_skb 的 reason 字段时程序未加载
+                skel_ = nullptr;
+                return;
+            }
+            percpu_counts_.resize(bpf.ncpus());
+            load_reason_names();
+        }
+
+        void collect(InterfaceMetrics &metrics) override
+        {
+            metrics.drops_total = 0;
+            metrics.drops.resize(0);
+
+            if (!skel_)
+                return;
+
+            uint32_t slot;
+            if (!slot_for(metrics.ifindex, slot))
+            {
+                if (metrics.ifindex != 0)
+                    ++untracked_;
+                return;
+            }
+
+            // 读取该网卡槽位在所有 CPU 上的计数
+            int map_fd = bpf_map__fd(skel_->maps.drop_counters);
+            if (bpf_map_lookup_elem(map_fd, &slot, percpu_counts_.data()) != 0)
+                return;
+
+            // 只导出非零的原因 (累计值)
+            for (int r = 0; r < DROP_REASON_SLOTS; ++r)
+            {
+                uint64_t n = 0;
+                for (const auto &c : percpu_counts_)
+                    n += c.reasons[r];
+                if (n == 0)
+                    continue;
+
+                metrics.drops.push_back({reason_names_[r].c_str(), n});
+                metrics.drops_total += n;
+            }
+        }
+
+        // 批量入口：逐网卡读取，再写入本轮没有分到槽位的网卡数
+        void collect_all(SystemSnapshot &snapshot) override
+        {
+            untracked_ = 0;
+            MonitorBase::collect_all(snapshot);
+            snapshot.drop_untracked_interfaces = untracked_;
+        }
+
+        // 网卡被移除：注销 ifindex 并清零槽位，留给之后的新网卡复用
+        void on_interface_removed(uint32_t ifindex, const std::string &) override
+        {
+            auto it = slots_.find(ifindex);
+            if (it == slots_.end())
+                return;
+
+            uint32_t slot = it->second;
+            slots_.erase(it);
+
+            bpf_map_delete_elem(bpf_map__fd(skel_->maps.drop_if_slot), &ifindex);
+
+            // 用户态更新 Per-CPU Array 会覆盖所有 CPU 的值
+            std::fill(percpu_counts_.begin(), percpu_counts_.end(), drop_counts{});
+            bpf_map_update_elem(bpf_map__fd(skel_->maps.drop_counters), &slot, percpu_counts_.data(), BPF_ANY);
+
+            free_slots_.push_back(slot);
+        }
+
+    private:
+        // Skeleton 由 BpfObject 拥有
+        struct tcp_loss_bpf *skel_ = nullptr;
+
+        // Per-CPU 读取缓冲区，构造时按 possible CPU 数量分配一次
+        std::vector<drop_counts> percpu_counts_;
+
+        // ifindex -> drop_counters 槽位，与 BPF 侧的 drop_if_slot 保持一致
+        std::unordered_map<uint32_t, uint32_t> slots_;
+        std::vector<uint32_t> free_slots_;
+        uint32_t next_slot_ = 0;
+        uint32_t max_slots_;
+        uint32_t untracked_ = 0; // 本轮因槽位用完而未统计的网卡数
+
+        // reason 数值 -> 名称 (如 "NETFILTER_DROP")
+        std::vector<std::string> reason_names_;
+
+        // 首次见到某个网卡时分配槽位并写入 drop_if_slot，之后 BPF 侧才开始计数
+        bool slot_for(uint32_t ifindex, uint32_t &slot)
+        {
+            if (ifindex == 0)
+                return false;
+
+            auto it = slots_.find(ifindex);
+            if (it != slots_.end())
+            {
+                slot = it->second;
+                return true;
+            }
+
+            // 优先复用已移除网卡释放的槽位
+            if (!free_slots_.empty())
+                slot = free_slots_.back();
+            else if (next_slot_ < max_slots_)
+                slot = next_slot_;
+            else
+                return false; // 槽位用完，该网卡不统计
+
+            int map_fd = bpf_map__fd(skel_->maps.drop_if_slot);
+            if (bpf_map_update_elem(map_fd, &ifindex, &slot, BPF_ANY) != 0)
+            {
+                perror("bpf_map_update_elem(drop_if_slot) failed");
+                return false;
+            }
+
+            if (!free_slots_.empty())
+                free_slots_.pop_back();
+            else
+                ++next_slot_;
+            slots_.emplace(ifindex, slot);
+            return true;
+        }
+
+        // 丢包原因的数值随内核版本变化，名称从 tracepoint 的 format 文件里解析：
+        //   print fmt: "...", __print_symbolic(REC->reason, { 2, "NOT_SPECIFIED" }, { 3, "NO_SOCKET" }, ...)
+        // 解析失败时退化为 "REASON_<n>"
+        void load_reason_names()
+        {
+            reason_names_.resize(DROP_REASON_SLOTS);
+            for (int r = 0; r < DROP_REASON_SLOTS; ++r)
+                reason_names_[r] = "REASON_" + std::to_string(r);
+
+            std::ifstream file("/sys/kernel/tracing/events/skb/kfree_skb/format");
+            if (!file)
+                file.open("/sys/kernel/debug/tracing/events/skb/kfree_skb/format");
+            if (!file)
+                return;
+
+            std::stringstream ss;
+            ss << file.rdbuf();
+            std::string fmt = ss.str();
+
+            size_t pos = fmt.find("__print_symbolic(REC->reason");
+            if (pos == std::string::npos)
+                return;
+
+            while ((pos = fmt.find('{', pos)) != std::string::npos)
+            {
+                char *end = nullptr;
+                long value = std::strtol(fmt.c_str() + pos + 1, &end, 0);
+                size_t q1 = fmt.find('"', pos);
+                size_t q2 = q1 == std::string::npos ? q1 : fmt.find('"', q1 + 1);
+                if (q2 == std::string::npos)
+                    break;
+
+                if (value >= 0 && value < DROP_REASON_SLOTS)
+                    reason_names_[value] = fmt.substr(q1 + 1, q2 - q1 - 1);
+                pos = q2 + 1;
+            }
+        }
+    };
+
+} // namespace flow_scope
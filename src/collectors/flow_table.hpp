@@ -0,0 +1,162 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "../bpf/tcp_loss.h"
+
+namespace flow_scope
+{
+
+    // 用户态每流重传表
+    // 开放寻址 + 线性探测，容量固定 (2 的幂)，运行期不再分配内存
+    // 每个条目正好一条 Cache Line，探测时顺序访问，对 CPU 缓存友好
+    class FlowTable
+    {
+    public:
+        struct alignas(64) Entry
+        {
+            flow_key key;
+            uint64_t total = 0;     // 累计重传次数
+            uint64_t delta = 0;     // delta_tick 这一轮新增的重传次数
+            uint32_t delta_tick = 0;
+            uint32_t last_tick = 0; // 最近一次有重传的 tick，用于老化
+            bool used = false;
+        };
+
+        // capacity 会向上取整到 2 的幂
+        // idle_ticks: 超过这么多 tick 没有新重传的流会被回收
+        explicit FlowTable(size_t capacity = 1 << 17, uint32_t idle_ticks = 300)
+            : idle_ticks_(idle_ticks)
+        {
+            size_t cap = 1;
+            while (cap < capacity)
+                cap <<= 1;
+            entries_.resize(cap);
+            mask_ = cap - 1;
+            // 负载因子上限 75%，保证探测链足够短
+            max_size_ = cap - cap / 4;
+        }
+
+        // 新的一轮采集开始
+        void begin_tick() { ++tick_; }
+        uint32_t tick() const { return tick_; }
+
+        // 合并一条增量，返回条目下标；表满时返回 -1 (新流被丢弃)
+        // first_in_tick 非空时写入：这是不是该流在本轮的第一条增量 (同一轮里同一个 key 可能被合并多次)
+        long add(const flow_key &key, uint64_t retrans, bool *first_in_tick = nullptr)
+        {
+            size_t i = hash(key) & mask_;
+            while (entries_[i].used)
+            {
+                if (key_equal(entries_[i].key, key))
+                    return touch(i, retrans, first_in_tick);
+                i = (i + 1) & mask_;
+            }
+
+            if (size_ >= max_size_)
+            {
+                ++dropped_;
+                return -1;
+            }
+
+            Entry &e = entries_[i];
+            e.key = key;
+            e.total = 0;
+            e.used = true;
+            ++size_;
+            return touch(i, retrans, first_in_tick);
+        }
+
+        // 老化：每次只扫描 budget 个槽位 (时钟指针)，把清理成本摊到每个 tick
+        void sweep(size_t budget)
+        {
+            for (size_t n = 0; n < budget && size_ > 0; ++n)
+            {
+                Entry &e = entries_[hand_];
+                if (e.used && tick_ - e.last_tick > idle_ticks_)
+                {
+                    erase(hand_);
+                    // 回移删除可能把后面的条目挪到当前位置，所以原地再检查一次
+                    continue;
+                }
+                hand_ = (hand_ + 1) & mask_;
+            }
+        }
+
+        const Entry &at(size_t i) const { return entries_[i]; }
+        size_t size() const { return size_; }
+        uint64_t dropped() const { return dropped_; }
+
+    private:
+        std::vector<Entry> entries_;
+        size_t mask_ = 0;
+        size_t size_ = 0;
+        size_t max_size_ = 0;
+        size_t hand_ = 0;
+        uint32_t tick_ = 0;
+        uint32_t idle_ticks_;
+        uint64_t dropped_ = 0;
+
+        long touch(size_t i, uint64_t retrans, bool *first_in_tick)
+        {
+            Entry &e = entries_[i];
+            bool first = e.delta_tick != tick_;
+            if (first)
+            {
+                e.delta = 0;
+                e.delta_tick = tick_;
+            }
+            if (first_in_tick)
+                *first_in_tick = first;
+            e.delta += retrans;
+            e.total += retrans;
+            e.last_tick = tick_;
+            return static_cast<long>(i);
+        }
+
+        // 线性探测的回移删除 (backward shift)，不留墓碑
+        void erase(size_t i)
+        {
+            size_t j = i;
+            while (true)
+            {
+                j = (j + 1) & mask_;
+                if (!entries_[j].used)
+                    break;
+                size_t home = hash(entries_[j].key) & mask_;
+                // home 不在 (i, j] 区间内，说明 j 可以挪到 i
+                if ((j > i && (home <= i || home > j)) ||
+                    (j < i && (home <= i && home > j)))
+                {
+                    entries_[i] = entries_[j];
+                    i = j;
+                }
+            }
+            entries_[i].used = false;
+            --size_;
+        }
+
+        static bool key_equal(const flow_key &a, const flow_key &b)
+        {
+            return std::memcmp(&a, &b, sizeof(flow_key)) == 0;
+        }
+
+        static size_t hash(const flow_key &key)
+        {
+            // 按 8 字节分块混合 (flow_key 共 40 字节)
+            static_assert(sizeof(flow_key) % sizeof(uint64_t) == 0, "flow_key must be 8-byte sized");
+            uint64_t words[sizeof(flow_key) / sizeof(uint64_t)];
+            std::memcpy(words, &key, sizeof(words));
+
+            uint64_t h = 0x9E3779B97F4A7C15ULL;
+            for (uint64_t w : words)
+            {
+                h ^= w;
+                h *= 0xFF51AFD7ED558CCDULL;
+                h ^= h >> 33;
+            }
+            return static_cast<size_t>(h);
+        }
+    };
+
+} // namespace flow_scope
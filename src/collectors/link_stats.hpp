@@ -0,0 +1,85 @@
+#pragma once
+#include <net/if.h>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace flow_scope
+{
+
+    // 单个网卡的全部计数器 (/proc/net/dev 的 16 列)
+    struct LinkStats
+    {
+        enum Column
+        {
+            RX_BYTES,
+            RX_PACKETS,
+            RX_ERRS,
+            RX_DROP,
+            RX_FIFO,
+            RX_FRAME,
+            RX_COMPRESSED,
+            RX_MULTICAST,
+            TX_BYTES,
+            TX_PACKETS,
+            TX_ERRS,
+            TX_DROP,
+            TX_FIFO,
+            TX_COLLS,
+            TX_CARRIER,
+            TX_COMPRESSED,
+            COLUMN_COUNT
+        };
+
+        char name[IFNAMSIZ] = {};
+        uint32_t ifindex = 0; // 数据源不提供时为 0
+        uint8_t name_len = 0;
+        uint64_t cols[COLUMN_COUNT] = {};
+
+        std::string_view name_view() const { return std::string_view(name, name_len); }
+    };
+
+    // 网卡计数器数据源 (procfs / netlink) 的公共部分
+    // 结果表只增不减，有效条目数为 count_，稳态下不分配内存
+    class LinkStatsReader
+    {
+    public:
+        virtual ~LinkStatsReader() = default;
+
+        // 重新读取所有网卡的计数器，失败返回 false
+        virtual bool read() = 0;
+
+        const std::vector<LinkStats> &links() const { return links_; }
+        size_t count() const { return count_; }
+
+        // 按名称查找，hint 为上次找到的位置 (网卡顺序通常不变，基本都是 O(1) 命中)
+        const LinkStats *find(std::string_view name, size_t &hint) const
+        {
+            if (hint < count_ && links_[hint].name_view() == name)
+                return &links_[hint];
+
+            for (size_t i = 0; i < count_; ++i)
+            {
+                if (links_[i].name_view() == name)
+                {
+                    hint = i;
+                    return &links_[i];
+                }
+            }
+            return nullptr;
+        }
+
+    protected:
+        std::vector<LinkStats> links_;
+        size_t count_ = 0;
+
+        // 追加一个条目，网卡数增长时才扩容
+        LinkStats &next_slot()
+        {
+            if (count_ == links_.size())
+                links_.emplace_back();
+            return links_[count_++];
+        }
+    };
+
+} // namespace flow_scope
@@ -1,12 +1,17 @@
 #pragma once
 #include "monitor_base.hpp"
+#include "flow_table.hpp"
+#include "bpf_object.hpp"
+#include "../core/scheduler.hpp"
 #include <bpf/libbpf.h>
 #include <bpf/bpf.h>
-#include <sys/resource.h>
+#include <arpa/inet.h>
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
 #include <iostream>
-
-// 包含自动生成的骨架头文件
-#include "tcp_loss.skel.h"
+#include <string>
+#include <vector>
 
 namespace flow_scope
 {
@@ -14,79 +19,261 @@ namespace flow_scope
     class LossMonitor : public MonitorBase
     {
     public:
-        LossMonitor()
+        explicit LossMonitor(BpfObject &bpf) : skel_(bpf.skel())
+        {
+            if (!skel_)
+                return;
+
+            // 预分配 Per-CPU 读取缓冲区
+            percpu_vals_.resize(bpf.ncpus());
+
+            // 预分配每流表的批量读取缓冲区
+            flow_keys_.resize(kFlowBatchSize);
+            flow_vals_.resize(kFlowBatchSize);
+            changed_.reserve(FLOW_MAP_MAX_ENTRIES);
+            event_ring_.resize(kEventRingSize);
+        }
+
+        ~LossMonitor()
         {
-            // 1. 调整 RLIMIT_MEMLOCK
-            // eBPF Map 需要锁定内存，默认限制通常太小，必须调大
-            struct rlimit rlim = {RLIM_INFINITY, RLIM_INFINITY};
-            if (setrlimit(RLIMIT_MEMLOCK, &rlim))
+            if (rb_)
             {
-                perror("setrlimit(RLIMIT_MEMLOCK) failed");
+                ring_buffer__free(rb_);
             }
+        }
 
-            // 2. 打开 Skeleton (Open)
-            skel_ = tcp_loss_bpf__open();
+        // 订阅重传事件流：Ring Buffer 的 fd 直接挂到 Scheduler 的 epoll 上，事件到达即消费
+        // BPF 侧只在积压超过 RETRANS_WAKEUP_BYTES 时才唤醒，
+        // 低于阈值的零星事件由 kEventFlushMs 的定时器兜底，保证延迟有上限
+        void attach_events(Scheduler &scheduler)
+        {
             if (!skel_)
-            {
-                std::cerr << "Failed to open BPF skeleton" << std::endl;
                 return;
-            }
 
-            // 3. 加载并验证 (Load)
-            if (tcp_loss_bpf__load(skel_))
+            int rb_fd = bpf_map__fd(skel_->maps.retrans_events);
+            rb_ = ring_buffer__new(rb_fd, &LossMonitor::on_event, this, nullptr);
+            if (!rb_)
             {
-                std::cerr << "Failed to load BPF skeleton" << std::endl;
-                tcp_loss_bpf__destroy(skel_);
-                skel_ = nullptr;
+                std::cerr << "Failed to create BPF ring buffer" << std::endl;
                 return;
             }
 
-            // 4. 挂载到内核 Tracepoint (Attach)
-            if (tcp_loss_bpf__attach(skel_))
-            {
-                std::cerr << "Failed to attach BPF skeleton" << std::endl;
-                tcp_loss_bpf__destroy(skel_);
-                skel_ = nullptr;
-                return;
-            }
+            // bpf_ktime_get_ns 是 CLOCK_MONOTONIC，预先算好到 Unix 时间的偏移
+            struct timespec mono, real;
+            clock_gettime(CLOCK_MONOTONIC, &mono);
+            clock_gettime(CLOCK_REALTIME, &real);
+            mono_to_real_ns_ = (real.tv_sec - mono.tv_sec) * 1000000000LL + (real.tv_nsec - mono.tv_nsec);
 
-            std::cout << "--> eBPF TCP Loss Monitor attached successfully!" << std::endl;
+            scheduler.add_io_task(rb_fd, [this]()
+                                  { ring_buffer__consume(rb_); });
+            scheduler.add_timer_task(kEventFlushMs, [this]()
+                                     { ring_buffer__consume(rb_); });
         }
 
-        ~LossMonitor()
+        // 单网卡重传数：按 ifindex 读取 Per-CPU 计数并求和
+        void collect(InterfaceMetrics &metrics) override
         {
-            if (skel_)
+            if (!skel_)
+                return;
+
+            metrics.tcp_retrans_total = 0;
+
+            uint32_t ifindex = metrics.ifindex;
+            if (ifindex == 0)
+                return;
+
+            int map_fd = bpf_map__fd(skel_->maps.tcp_retrans_by_ifindex);
+            if (bpf_map_lookup_elem(map_fd, &ifindex, percpu_vals_.data()) == 0)
             {
-                tcp_loss_bpf__destroy(skel_);
+                metrics.tcp_retrans_total = sum_percpu();
             }
+            // 查不到说明该网卡还没有发生过重传 (或已被 LRU 淘汰)，保持 0
         }
 
-        void collect(InterfaceMetrics &metrics) override
+        // 批量入口：先逐网卡读取重传数，再采集系统级指标
+        void collect_all(SystemSnapshot &snapshot) override
+        {
+            MonitorBase::collect_all(snapshot);
+            collect_system(snapshot);
+        }
+
+    private:
+        // 系统级指标：全局重传总数 + 每流 Top-K
+        // 抽干内核的每流重传表，合并进用户态 FlowTable，并把最严重的流写入快照
+        // 内核表每次都被清空，所以成本只和"上次以来有重传的流"数量成正比，
+        // 且每 kFlowBatchSize 条才一次系统调用
+        void collect_system(SystemSnapshot &snapshot)
         {
             if (!skel_)
+            {
+                snapshot.top_flows.resize(0);
                 return;
+            }
+
+            // 全局计数 (包含无法归属到网卡的重传)
+            int counter_fd = bpf_map__fd(skel_->maps.tcp_retrans_counter);
+            uint32_t key = COUNTER_RETRANS;
+            if (bpf_map_lookup_elem(counter_fd, &key, percpu_vals_.data()) == 0)
+            {
+                snapshot.tcp_retrans_total = sum_percpu();
+            }
+            key = COUNTER_EVENT_DROPS;
+            if (bpf_map_lookup_elem(counter_fd, &key, percpu_vals_.data()) == 0)
+            {
+                snapshot.retrans_events_dropped = sum_percpu();
+            }
 
-            // 5. 读取 Map 数据
-            // 在 BPF 代码中，我们定义了 Key=0 存储计数
-            uint32_t key = 0;
-            uint64_t val = 0;
+            // 最近的重传事件
+            collect_events(snapshot);
 
-            // 获取 Map 的文件描述符 (通过 skeleton 直接获取，非常方便)
-            int map_fd = bpf_map__fd(skel_->maps.tcp_retrans_counter);
+            int map_fd = bpf_map__fd(skel_->maps.tcp_flow_retrans);
 
-            // 执行查找
-            if (bpf_map_lookup_elem(map_fd, &key, &val) == 0)
+            flows_.begin_tick();
+            changed_.clear();
+
+            // 1. 批量读取并删除
+            uint32_t in_batch = 0, out_batch = 0;
+            bool first = true;
+            while (true)
             {
-                metrics.tcp_retrans_total = val;
-                std::cout << "[RETRANS] " << " Total=" << metrics.tcp_retrans_total << std::endl;
+                uint32_t count = kFlowBatchSize;
+                LIBBPF_OPTS(bpf_map_batch_opts, opts);
+                int err = bpf_map_lookup_and_delete_batch(map_fd, first ? nullptr : &in_batch, &out_batch,
+                                                          flow_keys_.data(), flow_vals_.data(), &count, &opts);
+
+                // 出错 (包括 ENOENT 表示读完) 时 count 仍然是有效的条目数
+                // 抽取期间内核可能把已删除的 key 重新插入，同一轮会读到两次：只在第一次记下标，避免 Top-K 里重复
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    bool first_in_tick = false;
+                    long idx = flows_.add(flow_keys_[i], flow_vals_[i].retrans, &first_in_tick);
+                    if (idx >= 0 && first_in_tick)
+                        changed_.push_back(static_cast<uint32_t>(idx));
+                }
+
+                if (err)
+                {
+                    if (errno != ENOENT)
+                        perror("bpf_map_lookup_and_delete_batch failed");
+                    break;
+                }
+                in_batch = out_batch;
+                first = false;
             }
 
-            // 注意：目前的 eBPF 代码统计的是“全局”重传，无法区分具体是哪个网卡。
-            // 所以我们把这个值赋给 metrics，表示系统级的状态。
+            // 2. 只在本轮有变化的流里选 Top-K
+            size_t k = std::min(kTopFlows, changed_.size());
+            std::partial_sort(changed_.begin(), changed_.begin() + k, changed_.end(),
+                              [this](uint32_t a, uint32_t b)
+                              { return flows_.at(a).delta > flows_.at(b).delta; });
+
+            snapshot.top_flows.resize(k);
+            for (size_t i = 0; i < k; ++i)
+            {
+                const auto &e = flows_.at(changed_[i]);
+                auto &out = snapshot.top_flows[i];
+                format_addr(e.key.family, e.key.saddr, out.src);
+                format_addr(e.key.family, e.key.daddr, out.dst);
+                out.sport = e.key.sport;
+                out.dport = e.key.dport;
+                out.retrans = e.delta;
+                out.retrans_total = e.total;
+            }
+
+            // 3. 老化 (放在最后，回移删除会移动条目，不能影响上面的下标)
+            flows_.sweep(kFlowSweepPerTick);
         }
 
-    private:
+        // Skeleton 由 BpfObject 拥有
         struct tcp_loss_bpf *skel_ = nullptr;
+
+        // Per-CPU 值的读取缓冲区，构造时按 possible CPU 数量分配一次
+        std::vector<uint64_t> percpu_vals_;
+
+        // --- 重传事件 ---
+        static constexpr int kEventFlushMs = 100;      // 未达唤醒阈值时的兜底消费周期
+        static constexpr size_t kEventRingSize = 256;  // 用户态保留的最近事件 (2 的幂)
+        static constexpr size_t kSnapshotEvents = 64;  // 每个快照最多导出的事件数
+
+        struct ring_buffer *rb_ = nullptr;
+        std::vector<retrans_event> event_ring_;
+        uint64_t event_head_ = 0;      // 累计收到的事件数
+        uint64_t event_published_ = 0; // 上次导出快照时的 event_head_
+        int64_t mono_to_real_ns_ = 0;
+
+        static int on_event(void *ctx, void *data, size_t size)
+        {
+            if (size < sizeof(retrans_event))
+                return 0;
+            auto *self = static_cast<LossMonitor *>(ctx);
+            self->event_ring_[self->event_head_ & (kEventRingSize - 1)] = *static_cast<const retrans_event *>(data);
+            self->event_head_++;
+            return 0;
+        }
+
+        void collect_events(SystemSnapshot &snapshot)
+        {
+            if (!rb_)
+            {
+                snapshot.retrans_events.resize(0);
+                return;
+            }
+
+            // 先把还没被唤醒消费的事件收进来
+            ring_buffer__consume(rb_);
+
+            size_t n = static_cast<size_t>(std::min<uint64_t>(event_head_ - event_published_, kSnapshotEvents));
+            snapshot.retrans_events.resize(n);
+            for (size_t i = 0; i < n; ++i)
+            {
+                const retrans_event &e = event_ring_[(event_head_ - n + i) & (kEventRingSize - 1)];
+                auto &out = snapshot.retrans_events[i];
+                out.ts_ns = e.ts_ns + mono_to_real_ns_;
+                format_addr(e.flow.family, e.flow.saddr, out.src);
+                format_addr(e.flow.family, e.flow.daddr, out.dst);
+                out.sport = e.flow.sport;
+                out.dport = e.flow.dport;
+                out.ifindex = e.ifindex;
+                out.state = tcp_state_name(e.state);
+            }
+            event_published_ = event_head_;
+        }
+
+        static const char *tcp_state_name(uint32_t state)
+        {
+            static const char *const names[] = {
+                "UNKNOWN", "ESTABLISHED", "SYN_SENT", "SYN_RECV", "FIN_WAIT1", "FIN_WAIT2", "TIME_WAIT",
+                "CLOSE", "CLOSE_WAIT", "LAST_ACK", "LISTEN", "CLOSING", "NEW_SYN_RECV"};
+            return state < sizeof(names) / sizeof(names[0]) ? names[state] : "UNKNOWN";
+        }
+
+        static constexpr uint32_t kFlowBatchSize = 4096;
+        static constexpr size_t kTopFlows = 10;
+        static constexpr size_t kFlowSweepPerTick = 2048;
+
+        FlowTable flows_;
+        std::vector<flow_key> flow_keys_;
+        std::vector<flow_stats> flow_vals_;
+        std::vector<uint32_t> changed_; // 本轮有变化的 FlowTable 下标
+
+        uint64_t sum_percpu() const
+        {
+            uint64_t total = 0;
+            for (uint64_t v : percpu_vals_)
+                total += v;
+            return total;
+        }
+
+        static void format_addr(uint16_t family, const uint8_t *addr, std::string &out)
+        {
+            char buf[INET6_ADDRSTRLEN];
+            // IPv4 地址以 v4-mapped 形式存放在后 4 字节
+            if (family == AF_INET)
+                inet_ntop(AF_INET, addr + 12, buf, sizeof(buf));
+            else
+                inet_ntop(AF_INET6, addr, buf, sizeof(buf));
+            out.assign(buf);
+        }
     };
 
 } // namespace flow_scope
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include "../core/metrics.hpp"
+#include <string>
 
 namespace flow_scope
 {
@@ -8,6 +9,21 @@ namespace flow_scope
     public:
         virtual ~MonitorBase() = default;
         virtual void collect(InterfaceMetrics &metrics) = 0;
+
+        // 批量入口：一次填充整个快照 (snapshot.interfaces 已由调用者准备好名字和 ifindex)
+        // 默认逐个网卡调用 collect；数据源可以一次读全的采集器应重写它，每个周期只读一次
+        virtual void collect_all(SystemSnapshot &snapshot)
+        {
+            for (auto &metrics : snapshot.interfaces)
+                collect(metrics);
+        }
+
+        // 网卡被移除时调用，清理采集器里与该网卡相关的状态 (默认无状态)
+        virtual void on_interface_removed(uint32_t ifindex, const std::string &name)
+        {
+            (void)ifindex;
+            (void)name;
+        }
     };
 
 } // namespace flow_scope
\ No newline at end of file
@@ -0,0 +1,162 @@
+#pragma once
+#include "link_stats.hpp"
+#include <linux/if_link.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace flow_scope
+{
+
+    // 基于 netlink 的网卡计数器读取器
+    // 通过常驻的 NETLINK_ROUTE socket 发送 RTM_GETLINK dump，
+    // 直接拿到内核的 64 位 rtnl_link_stats64 结构，内核不格式化文本，用户态也不解析文本
+    class NetlinkLinkStatsReader : public LinkStatsReader
+    {
+    public:
+        NetlinkLinkStatsReader()
+        {
+            fd_ = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+            if (fd_ < 0)
+            {
+                perror("socket(NETLINK_ROUTE) failed");
+                return;
+            }
+
+            struct sockaddr_nl addr = {};
+            addr.nl_family = AF_NETLINK;
+            if (bind(fd_, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+            {
+                perror("bind(NETLINK_ROUTE) failed");
+                close(fd_);
+                fd_ = -1;
+                return;
+            }
+
+            // 内核单条 dump 消息不超过 32KB 左右，留足余量
+            buf_.resize(64 * 1024);
+        }
+
+        ~NetlinkLinkStatsReader()
+        {
+            if (fd_ >= 0)
+                close(fd_);
+        }
+
+        NetlinkLinkStatsReader(const NetlinkLinkStatsReader &) = delete;
+        NetlinkLinkStatsReader &operator=(const NetlinkLinkStatsReader &) = delete;
+
+        bool read() override
+        {
+            if (fd_ < 0)
+                return false;
+
+            // 1. 发送 dump 请求
+            struct
+            {
+                struct nlmsghdr nlh;
+                struct ifinfomsg ifm;
+            } req = {};
+            req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+            req.nlh.nlmsg_type = RTM_GETLINK;
+            req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+            req.nlh.nlmsg_seq = ++seq_;
+            req.ifm.ifi_family = AF_UNSPEC;
+
+            if (send(fd_, &req, req.nlh.nlmsg_len, 0) < 0)
+            {
+                perror("send(RTM_GETLINK) failed");
+                return false;
+            }
+
+            // 2. 接收并解析，直到 NLMSG_DONE
+            count_ = 0;
+            while (true)
+            {
+                ssize_t n = recv(fd_, buf_.data(), buf_.size(), 0);
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    perror("recv(RTM_GETLINK) failed");
+                    return false;
+                }
+
+                int len = static_cast<int>(n);
+                for (auto *nlh = reinterpret_cast<struct nlmsghdr *>(buf_.data()); NLMSG_OK(nlh, len);
+                     nlh = NLMSG_NEXT(nlh, len))
+                {
+                    if (nlh->nlmsg_seq != seq_)
+                        continue; // 上一次未读完的残留
+                    if (nlh->nlmsg_type == NLMSG_DONE)
+                        return true;
+                    if (nlh->nlmsg_type == NLMSG_ERROR)
+                    {
+                        std::fprintf(stderr, "RTM_GETLINK dump returned error\n");
+                        return false;
+                    }
+                    if (nlh->nlmsg_type == RTM_NEWLINK)
+                        parse_link(nlh);
+                }
+            }
+        }
+
+    private:
+        int fd_ = -1;
+        uint32_t seq_ = 0;
+        std::vector<char> buf_;
+
+        void parse_link(struct nlmsghdr *nlh)
+        {
+            auto *ifm = static_cast<struct ifinfomsg *>(NLMSG_DATA(nlh));
+            int attr_len = static_cast<int>(IFLA_PAYLOAD(nlh));
+
+            const char *name = nullptr;
+            const struct rtnl_link_stats64 *stats = nullptr;
+
+            for (struct rtattr *rta = IFLA_RTA(ifm); RTA_OK(rta, attr_len); rta = RTA_NEXT(rta, attr_len))
+            {
+                if (rta->rta_type == IFLA_IFNAME)
+                    name = static_cast<const char *>(RTA_DATA(rta));
+                else if (rta->rta_type == IFLA_STATS64 && RTA_PAYLOAD(rta) >= sizeof(struct rtnl_link_stats64))
+                    stats = static_cast<const struct rtnl_link_stats64 *>(RTA_DATA(rta));
+            }
+            if (!name || !stats)
+                return;
+
+            LinkStats &link = next_slot();
+            link.ifindex = static_cast<uint32_t>(ifm->ifi_index);
+            size_t name_len = strnlen(name, IFNAMSIZ - 1);
+            std::memcpy(link.name, name, name_len);
+            link.name[name_len] = '\0';
+            link.name_len = static_cast<uint8_t>(name_len);
+
+            // 按内核 dev_seq_printf_stats() 的口径映射到 /proc/net/dev 的 16 列，两种后端结果一致
+            uint64_t *c = link.cols;
+            c[LinkStats::RX_BYTES] = stats->rx_bytes;
+            c[LinkStats::RX_PACKETS] = stats->rx_packets;
+            c[LinkStats::RX_ERRS] = stats->rx_errors;
+            c[LinkStats::RX_DROP] = stats->rx_dropped + stats->rx_missed_errors;
+            c[LinkStats::RX_FIFO] = stats->rx_fifo_errors;
+            c[LinkStats::RX_FRAME] = stats->rx_length_errors + stats->rx_over_errors +
+                                     stats->rx_crc_errors + stats->rx_frame_errors;
+            c[LinkStats::RX_COMPRESSED] = stats->rx_compressed;
+            c[LinkStats::RX_MULTICAST] = stats->multicast;
+            c[LinkStats::TX_BYTES] = stats->tx_bytes;
+            c[LinkStats::TX_PACKETS] = stats->tx_packets;
+            c[LinkStats::TX_ERRS] = stats->tx_errors;
+            c[LinkStats::TX_DROP] = stats->tx_dropped;
+            c[LinkStats::TX_FIFO] = stats->tx_fifo_errors;
+            c[LinkStats::TX_COLLS] = stats->collisions;
+            c[LinkStats::TX_CARRIER] = stats->tx_carrier_errors + stats->tx_aborted_errors +
+                                       stats->tx_window_errors + stats->tx_heartbeat_errors;
+            c[LinkStats::TX_COMPRESSED] = stats->tx_compressed;
+        }
+    };
+
+} // namespace flow_scope
@@ -0,0 +1,136 @@
+#pragma once
+#include "link_stats.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace flow_scope
+{
+
+    // /proc/net/dev 读取器
+    // - 文件描述符常驻，每次从偏移 0 pread，不再反复 open/close
+    // - 读缓冲区和结果表都复用，稳态下零内存分配
+    // - 一次遍历解析所有网卡的全部 16 列，手写整数扫描，不经过 stringstream
+    class ProcNetDevReader : public LinkStatsReader
+    {
+    public:
+        explicit ProcNetDevReader(const std::string &path = "/proc/net/dev")
+        {
+            fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd_ < 0)
+                perror("open /proc/net/dev failed");
+            buf_.resize(64 * 1024);
+        }
+
+        ~ProcNetDevReader()
+        {
+            if (fd_ >= 0)
+                close(fd_);
+        }
+
+        ProcNetDevReader(const ProcNetDevReader &) = delete;
+        ProcNetDevReader &operator=(const ProcNetDevReader &) = delete;
+
+        // 重新读取并解析整个文件，失败返回 false
+        bool read() override
+        {
+            if (fd_ < 0)
+                return false;
+
+            // 1. 读完整个文件
+            // procfs 一次 read 可能只返回部分内容，按顺序偏移继续读直到返回 0
+            size_t len = 0;
+            while (true)
+            {
+                if (len == buf_.size())
+                    buf_.resize(buf_.size() * 2); // 网卡数增长时才扩容
+                ssize_t n = pread(fd_, buf_.data() + len, buf_.size() - len, static_cast<off_t>(len));
+                if (n < 0)
+                {
+                    perror("pread /proc/net/dev failed");
+                    return false;
+                }
+                if (n == 0)
+                    break;
+                len += static_cast<size_t>(n);
+            }
+
+            // 2. 解析
+            parse(buf_.data(), buf_.data() + len);
+            return true;
+        }
+
+        // 解析一段完整的 /proc/net/dev 内容 (公开出来便于基准测试)
+        void parse(const char *p, const char *end)
+        {
+            count_ = 0;
+
+            // 跳过前两行表头
+            p = skip_line(p, end);
+            p = skip_line(p, end);
+
+            while (p < end)
+            {
+                // 格式: "  eth0: 123 456 ..." (名字很长时冒号后可能没有空格)
+                while (p < end && *p == ' ')
+                    ++p;
+
+                const char *name_begin = p;
+                while (p < end && *p != ':' && *p != '\n')
+                    ++p;
+                if (p >= end || *p != ':')
+                {
+                    p = skip_line(p, end);
+                    continue;
+                }
+
+                size_t name_len = static_cast<size_t>(p - name_begin);
+                ++p; // 跳过 ':'
+
+                LinkStats &link = next_slot();
+                link.ifindex = 0; // /proc/net/dev 不提供 ifindex
+
+                if (name_len >= IFNAMSIZ)
+                    name_len = IFNAMSIZ - 1;
+                std::memcpy(link.name, name_begin, name_len);
+                link.name[name_len] = '\0';
+                link.name_len = static_cast<uint8_t>(name_len);
+
+                for (int c = 0; c < LinkStats::COLUMN_COUNT; ++c)
+                    p = scan_u64(p, end, link.cols[c]);
+
+                p = skip_line(p, end);
+            }
+        }
+
+    private:
+        int fd_ = -1;
+        std::vector<char> buf_;
+
+        static const char *skip_line(const char *p, const char *end)
+        {
+            const void *nl = std::memchr(p, '\n', static_cast<size_t>(end - p));
+            return nl ? static_cast<const char *>(nl) + 1 : end;
+        }
+
+        // 跳过空白后读取一个十进制无符号整数，不做本地化、不做溢出检查
+        static const char *scan_u64(const char *p, const char *end, uint64_t &out)
+        {
+            while (p < end && *p == ' ')
+                ++p;
+
+            uint64_t v = 0;
+            while (p < end && static_cast<unsigned>(*p - '0') < 10u)
+            {
+                v = v * 10 + static_cast<unsigned>(*p - '0');
+                ++p;
+            }
+            out = v;
+            return p;
+        }
+    };
+
+} // namespace flow_scope
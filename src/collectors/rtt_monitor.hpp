@@ -1,9 +1,18 @@
 #pragma once
 #include "monitor_base.hpp"
+#include "../core/scheduler.hpp"
 #include <iostream>
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
 #include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
 #include <arpa/inet.h>
+#include <linux/errqueue.h>
+#include <linux/filter.h>
+#include <linux/net_tstamp.h>
 #include <sys/socket.h>
 #include <unistd.h>
 #include <netinet/ip.h>
@@ -22,32 +31,108 @@ namespace flow_scope
         uint16_t sequence;
     };
 
+    // ICMP 探测 (异步，多目标)
+    // 发送和接收分离：采集周期里向每个目标发出一个探测包，不等待；所有目标共用一个 Raw Socket，
+    // 挂在 Scheduler 的 epoll 上，回包到达时按 (id, seq) 在在途表里找到对应的目标和发送时间算出 RTT；
+    // 超时由定时器统一清理。丢包不会卡住事件循环，在途探测数只受在途表大小限制
+    //
+    // RTT 优先用内核软件时间戳 (SO_TIMESTAMPING) 计算：发送时间取自网卡驱动发包时刻 (从错误队列读回)，
+    // 接收时间取自协议栈收包时刻，不包含本进程的调度延迟和系统调用耗时；
+    // 同时保留用户态 steady_clock 测得的 RTT，两者之差就是 agent 自身对测量的干扰
+    //
+    // 收发都按批进行：一轮探测用 sendmmsg 每 batch_size 个目标一次系统调用，回包和发送时间戳用 recvmmsg
+    // 读进预分配的缓冲区；校验和按序号增量计算，不再逐字节求和
     class RttMonitor : public MonitorBase
     {
     public:
-        // target_ip: 要 Ping 的目标 IP，默认为 8.8.8.8 (Google DNS)
-        RttMonitor(const std::string &target_ip = "8.8.8.8") : target_ip_(target_ip)
+        static constexpr int kProbeTimeoutMs = 1000;     // 超过这个时间没收到回包算丢包
+        static constexpr int kExpireCheckMs = 100;       // 超时检查的间隔 (丢包判定最多晚这么久)
+        static constexpr size_t kMinInFlight = 4096;     // 在途表最小容量
+        static constexpr size_t kMaxInFlight = 65536;    // 在途表最大容量 (seq 只有 16 位)
+        static constexpr uint32_t kDefaultLossWindow = 100; // 丢包率默认统计最近多少个探测
+        static constexpr uint32_t kMaxLossWindow = 65536;
+        static constexpr size_t kMaxBatch = 64;          // sendmmsg / recvmmsg 一次最多处理的包数
+        static constexpr size_t kRxBufSize = 256;        // 每个接收缓冲区 (只需要 IP 头 + ICMP 头)
+        static constexpr size_t kControlSize = 128;      // 每个控制消息缓冲区 (放 SCM_TIMESTAMPING)
+
+        // targets: 要 Ping 的目标 IPv4 地址，第一个目标同时作为各网卡的 rtt_ms / packet_loss_rate
+        // kernel_filter: 在 socket 上挂 BPF 过滤器，只让发给本进程的 Echo Reply 进入接收队列
+        // batch_size: 每次 sendmmsg / recvmmsg 的包数 (1 ~ kMaxBatch，1 相当于逐包收发)
+        // loss_window: 丢包率按每个目标最近多少个有结果的探测计算 (1 ~ kMaxLossWindow)
+        explicit RttMonitor(const std::vector<std::string> &targets = {"8.8.8.8"}, bool kernel_filter = true,
+                            size_t batch_size = kMaxBatch, uint32_t loss_window = kDefaultLossWindow)
+            : kernel_filter_(kernel_filter), loss_window_(std::min(std::max<uint32_t>(loss_window, 1), kMaxLossWindow)),
+              loss_words_((loss_window_ + 63) / 64), batch_(std::min(std::max<size_t>(batch_size, 1), kMaxBatch))
         {
-            // 1. 创建 Raw Socket
-            sockfd_ = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
+            // 1. 创建非阻塞 Raw Socket (回包由 epoll 通知，不再用 SO_RCVTIMEO 阻塞等待)
+            sockfd_ = socket(AF_INET, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_ICMP);
             if (sockfd_ < 0)
             {
                 perror("Socket creation failed (ROOT required?)");
                 // 在实际工程中这里应该抛出异常或通过状态位通知
             }
 
-            // 2. 设置接收超时 (1秒)，避免程序卡死
-            struct timeval timeout;
-            timeout.tv_sec = 1;
-            timeout.tv_usec = 0;
-            setsockopt(sockfd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            // 2. 准备目标地址结构 (无法解析的地址跳过)
+            targets_.reserve(targets.size());
+            for (const auto &ip : targets)
+            {
+                Target t;
+                t.name = ip;
+                t.addr.sin_family = AF_INET;
+                if (inet_pton(AF_INET, ip.c_str(), &t.addr.sin_addr) != 1)
+                {
+                    std::cerr << "RttMonitor: invalid IPv4 target " << ip << std::endl;
+                    continue;
+                }
+                targets_.push_back(t);
+            }
 
-            // 3. 准备目标地址结构
-            dest_addr_.sin_family = AF_INET;
-            inet_pton(AF_INET, target_ip_.c_str(), &dest_addr_.sin_addr);
+            // 内核收发时间戳 (失败时退回用户态计时)
+            int ts_flags = SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+            kernel_timestamps_ = sockfd_ >= 0 &&
+                                 setsockopt(sockfd_, SOL_SOCKET, SO_TIMESTAMPING, &ts_flags, sizeof(ts_flags)) == 0;
+            if (sockfd_ >= 0 && !kernel_timestamps_)
+                perror("setsockopt(SO_TIMESTAMPING) failed, measuring RTT in userspace");
 
             // 使用进程ID作为 ICMP ID，便于识别
-            packet_id_ = static_cast<uint16_t>(getpid() & 0xFFFF);
+            set_packet_id(static_cast<uint16_t>(getpid() & 0xFFFF));
+
+            // 在途表一次性分配，之后发送和接收都不分配内存
+            // 每个周期每个目标一个探测，超时前最多积压约 2 个周期，按 4 倍目标数留余量
+            size_t cap = kMinInFlight;
+            while (cap < targets_.size() * 4 && cap < kMaxInFlight)
+                cap *= 2;
+            if (targets_.size() * 2 > cap)
+                std::cerr << "RttMonitor: " << targets_.size()
+                          << " targets exceed the in-flight table, some probes will be counted as lost" << std::endl;
+            in_flight_.resize(cap);
+            mask_ = cap - 1;
+
+            // 一轮的探测同时发出、回包几乎同时到达，收发缓冲区按目标数放大
+            // (每个包的 skb 约 1KB，受 rmem_max / wmem_max 限制)
+            int bufsize = static_cast<int>(targets_.size() * 2048);
+            if (sockfd_ >= 0 && bufsize > 256 * 1024)
+            {
+                setsockopt(sockfd_, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+                setsockopt(sockfd_, SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+            }
+
+            // 每个目标一段定长的丢包位环，全部放在一块连续内存里 (targets_ 之后不再增减，指针稳定)
+            loss_ring_.assign(targets_.size() * loss_words_, 0);
+            for (size_t i = 0; i < targets_.size(); ++i)
+                targets_[i].loss_ring = &loss_ring_[i * loss_words_];
+
+            // 批量收发的缓冲区
+            tx_msgs_.resize(batch_);
+            tx_iov_.resize(batch_);
+            tx_packets_.resize(batch_);
+            tx_seq_.resize(batch_);
+            tx_ok_.resize(batch_);
+            rx_msgs_.resize(batch_);
+            rx_iov_.resize(batch_);
+            rx_from_.resize(batch_);
+            rx_data_.resize(batch_ * kRxBufSize);
+            rx_control_.resize(batch_ * kControlSize);
         }
 
         ~RttMonitor()
@@ -56,107 +141,514 @@ namespace flow_scope
                 close(sockfd_);
         }
 
-        void collect(InterfaceMetrics &metrics) override
+        RttMonitor(const RttMonitor &) = delete;
+        RttMonitor &operator=(const RttMonitor &) = delete;
+
+        // 把 socket 挂到事件循环上：可读时收包，定时清理超时的探测
+        // 错误队列里有发送时间戳时 epoll 报 EPOLLERR (无需注册)，同样走这个回调
+        void attach(Scheduler &scheduler)
         {
             if (sockfd_ < 0)
+                return;
+
+            scheduler.add_io_task(sockfd_, [this]()
+                                  { handle_replies(); });
+            scheduler.add_timer_task(kExpireCheckMs, [this]()
+                                     { expire(std::chrono::steady_clock::now()); });
+        }
+
+        // 写入第一个目标的最近一次 RTT 和窗口丢包率 (不发包，不阻塞)
+        void collect(InterfaceMetrics &metrics) override
+        {
+            if (sockfd_ < 0 || targets_.empty())
             {
                 metrics.rtt_ms = -1; // 错误状态
                 return;
             }
+            fill_interface(metrics, loss_rate(targets_[0]));
+        }
 
-            // --- 发送阶段 ---
-            char send_buf[64]; // 数据包缓冲区
-            memset(send_buf, 0, sizeof(send_buf));
+        // ICMP 探测的是到固定目标的 RTT，与网卡无关：每个周期向每个目标发出一个探测，
+        // 并把已经有结果的统计写进快照 (本周期的回包在下个周期体现)
+        void collect_all(SystemSnapshot &snapshot) override
+        {
+            if (sockfd_ >= 0)
+                send_round();
 
-            IcmpHeader *icmp = (IcmpHeader *)send_buf;
-            icmp->type = 8; // ICMP Echo Request
-            icmp->code = 0;
-            icmp->id = htons(packet_id_);
-            icmp->sequence = htons(seq_++);
-            icmp->checksum = 0;
-            // 计算校验和
-            icmp->checksum = calculate_checksum((uint16_t *)icmp, sizeof(IcmpHeader));
+            // 各网卡写的都是第一个目标的值，丢包率只算一次
+            if (sockfd_ < 0 || targets_.empty())
+            {
+                for (auto &metrics : snapshot.interfaces)
+                    collect(metrics);
+            }
+            else
+            {
+                double rate = loss_rate(targets_[0]);
+                for (auto &metrics : snapshot.interfaces)
+                    fill_interface(metrics, rate);
+            }
 
-            auto start_time = std::chrono::steady_clock::now();
+            // 目标列表固定，resize 复用上一轮的元素；IPv4 地址字符串落在 SSO 里，稳态下不分配
+            snapshot.rtt_targets.resize(targets_.size());
+            for (size_t i = 0; i < targets_.size(); ++i)
+                fill(targets_[i], snapshot.rtt_targets[i]);
+        }
+
+        // 更换 ICMP ID (如 fork 之后)，同时替换内核过滤器
+        // 旧 ID 的在途探测收不到回包，会按超时计为丢包
+        void set_packet_id(uint16_t id)
+        {
+            packet_id_ = id;
+            // 校验和里与序号无关的部分：type/code 字 (0x0800) + id
+            uint32_t sum = 0x0800u + id;
+            checksum_base_ = (sum >> 16) + (sum & 0xFFFF);
+            if (kernel_filter_ && sockfd_ >= 0)
+                attach_filter();
+        }
 
-            ssize_t sent = sendto(sockfd_, send_buf, sizeof(IcmpHeader), 0,
-                                  (struct sockaddr *)&dest_addr_, sizeof(dest_addr_));
-            if (sent <= 0)
+        // 当前在途 (已发送、未回包也未超时) 的探测数
+        size_t in_flight() const { return in_flight_count_; }
+
+        // 接收侧被唤醒的次数，以及读到后在用户态丢掉的包数 (不是本进程的回包)
+        uint64_t rx_wakeups() const { return rx_wakeups_; }
+        uint64_t rx_discarded() const { return rx_discarded_; }
+
+        // 是否在用内核时间戳计算 RTT
+        bool kernel_timestamps() const { return kernel_timestamps_; }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        // 一个探测目标及其统计 (定长，目标列表在构造时确定)
+        struct Target
+        {
+            struct sockaddr_in addr = {};
+            std::string name;
+            double last_rtt_ms = 0.0;   // 最近一个有结果的探测的 RTT (丢包为 0)
+            double last_reply_ms = 0.0; // 最近一次回包的 RTT (算抖动用)
+            double user_last_ms = 0.0;  // 用户态测得的 RTT (最近一次 / 累计和)
+            double user_sum_ms = 0.0;
+            double min_ms = 0.0;
+            double max_ms = 0.0;
+            double sum_ms = 0.0;
+            double jitter_ms = 0.0;
+            uint64_t sent = 0;
+            uint64_t received = 0;
+            // 丢包位环：最近 loss_window_ 个结果各占一位 (1 = 丢包)，loss_pos 是下一个要写的位置
+            uint64_t *loss_ring = nullptr;
+            uint32_t loss_pos = 0;
+            uint32_t loss_samples = 0; // 环里已写入的结果数 (写满后等于窗口大小)
+            uint32_t loss_count = 0;   // 环里置位的个数，随写入增量维护
+        };
+
+        // 在途表的一项，按 seq 低位直接寻址
+        struct Probe
+        {
+            Clock::time_point sent_at;
+            int64_t tx_ns = 0; // 内核发送时间戳 (CLOCK_REALTIME，纳秒)，0 表示还没读到
+            uint32_t target = 0;
+            uint16_t id = 0;
+            uint16_t seq = 0;
+            bool in_use = false;
+        };
+
+        int sockfd_;
+        bool kernel_filter_;
+        bool kernel_timestamps_ = false;
+        std::vector<Target> targets_;
+        uint16_t packet_id_ = 0;
+        uint32_t checksum_base_ = 0;
+        uint16_t seq_ = 0;         // 下一个要发送的序号 (所有目标共用)
+        uint16_t oldest_seq_ = 0;  // 可能仍在途的最旧序号 (超时清理从这里开始)
+        std::vector<Probe> in_flight_;
+        size_t mask_ = 0;
+        size_t in_flight_count_ = 0;
+        uint64_t rx_wakeups_ = 0;
+        uint64_t rx_discarded_ = 0;
+
+        // 丢包位环 (每个目标 loss_words_ 个 64 位字)
+        uint32_t loss_window_;
+        size_t loss_words_;
+        std::vector<uint64_t> loss_ring_;
+
+        // 批量收发的缓冲区 (构造时分配，长度都是 batch_)
+        size_t batch_;
+        std::vector<struct mmsghdr> tx_msgs_;
+        std::vector<struct iovec> tx_iov_;
+        std::vector<IcmpHeader> tx_packets_;
+        std::vector<uint16_t> tx_seq_;
+        std::vector<uint8_t> tx_ok_;
+        std::vector<struct mmsghdr> rx_msgs_;
+        std::vector<struct iovec> rx_iov_;
+        std::vector<struct sockaddr_in> rx_from_;
+        std::vector<char> rx_data_;
+        std::vector<char> rx_control_;
+
+        Probe &slot(uint16_t seq) { return in_flight_[seq & mask_]; }
+
+        // Echo Request 的校验和 (RFC 1071 反码和)：头部只有 seq 随探测变化，
+        // 与序号无关的部分预先算好放在 checksum_base_，每个序号只需再加一个 16 位字并折叠 (RFC 1624 的增量更新)
+        uint16_t echo_checksum(uint16_t seq) const
+        {
+            uint32_t sum = checksum_base_ + seq;
+            sum = (sum >> 16) + (sum & 0xFFFF);
+            sum += sum >> 16;
+            return htons(static_cast<uint16_t>(~sum));
+        }
+
+        // 向所有目标各发一个探测，每 batch_ 个目标一次 sendmmsg
+        void send_round()
+        {
+            for (size_t begin = 0; begin < targets_.size(); begin += batch_)
             {
-                metrics.packet_loss_rate = 1.0; // 发送失败算丢包
-                return;
+                size_t n = std::min(batch_, targets_.size() - begin);
+
+                // 1. 填好这一批的包和消息头
+                for (size_t k = 0; k < n; ++k)
+                {
+                    Target &t = targets_[begin + k];
+
+                    // 槽位被在途表容量个序号之前的探测占着：它早已超时，先按丢包结算
+                    Probe &p = slot(seq_);
+                    if (p.in_use)
+                        settle_lost(p);
+
+                    IcmpHeader &icmp = tx_packets_[k];
+                    icmp.type = 8; // ICMP Echo Request
+                    icmp.code = 0;
+                    icmp.id = htons(packet_id_);
+                    icmp.sequence = htons(seq_);
+                    icmp.checksum = echo_checksum(seq_);
+                    tx_seq_[k] = seq_++;
+                    tx_ok_[k] = 0;
+                    ++t.sent;
+
+                    tx_iov_[k].iov_base = &icmp;
+                    tx_iov_[k].iov_len = sizeof(IcmpHeader);
+                    struct msghdr &h = tx_msgs_[k].msg_hdr;
+                    std::memset(&h, 0, sizeof(h));
+                    h.msg_name = &t.addr;
+                    h.msg_namelen = sizeof(t.addr);
+                    h.msg_iov = &tx_iov_[k];
+                    h.msg_iovlen = 1;
+                }
+
+                // 2. 发送。每批单独取时间，否则一轮里靠后的目标会把前面的发送耗时算进用户态 RTT
+                Clock::time_point now = Clock::now();
+                size_t done = 0;
+                while (done < n)
+                {
+                    int r = sendmmsg(sockfd_, &tx_msgs_[done], static_cast<unsigned>(n - done), 0);
+                    if (r > 0)
+                    {
+                        for (size_t k = done; k < done + static_cast<size_t>(r); ++k)
+                            tx_ok_[k] = 1;
+                        done += static_cast<size_t>(r);
+                        continue;
+                    }
+                    if (r < 0 && errno == EINTR)
+                        continue;
+                    if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS))
+                        break; // 发送缓冲区满：这一批剩下的都算丢包
+                    ++done;    // 出错的是 done 这一个 (如目标不可达)，跳过它继续发后面的
+                }
+
+                // 3. 发出去的登记到在途表，没发出去的算丢包
+                for (size_t k = 0; k < n; ++k)
+                {
+                    uint32_t target = static_cast<uint32_t>(begin + k);
+                    if (!tx_ok_[k])
+                    {
+                        record_loss(targets_[target]);
+                        continue;
+                    }
+
+                    Probe &p = slot(tx_seq_[k]);
+                    p.sent_at = now;
+                    p.tx_ns = 0;
+                    p.target = target;
+                    p.id = packet_id_;
+                    p.seq = tx_seq_[k];
+                    p.in_use = true;
+                    ++in_flight_count_;
+                }
             }
+        }
 
-            // --- 接收阶段 ---
-            char recv_buf[1024];
-            struct sockaddr_in from_addr;
-            socklen_t addr_len = sizeof(from_addr);
+        // 一次 recvmmsg 读最多 batch_ 个包到 rx_* 缓冲区 (flags 为 0 或 MSG_ERRQUEUE)，返回包数，没有数据时返回 0
+        int receive_batch(int flags)
+        {
+            for (size_t k = 0; k < batch_; ++k)
+            {
+                rx_iov_[k].iov_base = &rx_data_[k * kRxBufSize];
+                rx_iov_[k].iov_len = kRxBufSize;
+                struct msghdr &h = rx_msgs_[k].msg_hdr;
+                std::memset(&h, 0, sizeof(h));
+                h.msg_name = &rx_from_[k];
+                h.msg_namelen = sizeof(rx_from_[k]);
+                h.msg_iov = &rx_iov_[k];
+                h.msg_iovlen = 1;
+                h.msg_control = &rx_control_[k * kControlSize];
+                h.msg_controllen = kControlSize;
+            }
 
             while (true)
             {
-                ssize_t received = recvfrom(sockfd_, recv_buf, sizeof(recv_buf), 0,
-                                            (struct sockaddr *)&from_addr, &addr_len);
+                int n = recvmmsg(sockfd_, rx_msgs_.data(), static_cast<unsigned>(batch_), flags | MSG_DONTWAIT, nullptr);
+                if (n >= 0)
+                    return n;
+                if (errno == EINTR)
+                    continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK && !(flags & MSG_ERRQUEUE))
+                    perror("recvmmsg(ICMP) failed");
+                return 0;
+            }
+        }
 
-                auto end_time = std::chrono::steady_clock::now();
+        // socket 可读：把错误队列和接收队列都读空 (水平触发，读不完会被反复唤醒)
+        // 先读发送时间戳：它在包发出时就已入队，一定早于对应的回包
+        void handle_replies()
+        {
+            ++rx_wakeups_;
 
-                if (received <= 0)
+            if (kernel_timestamps_)
+            {
+                while (true)
                 {
-                    // 超时或错误
-                    metrics.packet_loss_rate = 1.0; // 丢包
-                    metrics.rtt_ms = 0;
-                    break;
+                    int n = receive_batch(MSG_ERRQUEUE);
+                    for (int k = 0; k < n; ++k)
+                        handle_tx_timestamp(static_cast<size_t>(k));
+                    if (static_cast<size_t>(n) < batch_)
+                        break;
                 }
+            }
 
-                // --- 解析包 ---
-                // 接收到的数据包含 IP 头 + ICMP 头
-                // IP 头部通常是 20 字节
-                struct ip *ip_hdr = (struct ip *)recv_buf;
-                int ip_header_len = ip_hdr->ip_hl * 4;
+            while (true)
+            {
+                int n = receive_batch(0);
+                Clock::time_point now = Clock::now();
+                for (int k = 0; k < n; ++k)
+                    handle_reply(static_cast<size_t>(k), now);
+                if (static_cast<size_t>(n) < batch_)
+                    break;
+            }
+        }
 
-                if (received < ip_header_len + (int)sizeof(IcmpHeader))
-                    continue;
+        // 处理 rx_* 缓冲区里的第 k 个回包
+        void handle_reply(size_t k, Clock::time_point now)
+        {
+            char *recv_buf = &rx_data_[k * kRxBufSize];
+            ssize_t received = static_cast<ssize_t>(rx_msgs_[k].msg_len);
+            const struct sockaddr_in &from_addr = rx_from_[k];
+            struct msghdr &msg = rx_msgs_[k].msg_hdr;
 
-                IcmpHeader *icmp_reply = (IcmpHeader *)(recv_buf + ip_header_len);
+            // --- 解析包 ---
+            // 接收到的数据包含 IP 头 + ICMP 头
+            struct ip *ip_hdr = (struct ip *)recv_buf;
+            int ip_header_len = ip_hdr->ip_hl * 4;
 
-                // 检查是否是我们的包 (ID 和 Sequence 匹配)
-                if (icmp_reply->type == 0 && // Echo Reply
-                    icmp_reply->id == htons(packet_id_) &&
-                    icmp_reply->sequence == htons(seq_ - 1))
-                {
+            if (received < ip_header_len + (int)sizeof(IcmpHeader))
+            {
+                ++rx_discarded_;
+                return;
+            }
 
-                    // 计算 RTT
-                    std::chrono::duration<double, std::milli> rtt = end_time - start_time;
-                    metrics.rtt_ms = rtt.count();
-                    metrics.packet_loss_rate = 0.0;
-                    break; // 成功
-                }
+            IcmpHeader *icmp_reply = (IcmpHeader *)(recv_buf + ip_header_len);
+
+            // 只要 Echo Reply；没有内核过滤器时 Raw Socket 会收到本机所有 ICMP 包，其余的直接丢掉
+            if (icmp_reply->type != 0)
+            {
+                ++rx_discarded_;
+                return;
             }
+
+            // 按 (id, seq) 查在途表；重复或已超时的回包找不到对应项，
+            // 源地址还要和这个探测的目标一致 (防止别的主机的同号回包被算进来)
+            uint16_t id = ntohs(icmp_reply->id);
+            uint16_t seq = ntohs(icmp_reply->sequence);
+            Probe &p = slot(seq);
+            if (!p.in_use || p.id != id || p.seq != seq ||
+                targets_[p.target].addr.sin_addr.s_addr != from_addr.sin_addr.s_addr)
+            {
+                ++rx_discarded_;
+                return;
+            }
+
+            // 两个内核时间戳都有时用内核 RTT，否则退回用户态 RTT
+            std::chrono::duration<double, std::milli> user_rtt = now - p.sent_at;
+            int64_t rx_ns = kernel_timestamps_ ? timestamp_ns(msg) : 0;
+            double rtt_ms = user_rtt.count();
+            if (rx_ns > 0 && p.tx_ns > 0 && rx_ns >= p.tx_ns)
+                rtt_ms = static_cast<double>(rx_ns - p.tx_ns) / 1e6;
+            record_reply(targets_[p.target], rtt_ms, user_rtt.count());
+            p.in_use = false;
+            --in_flight_count_;
         }
 
-    private:
-        int sockfd_;
-        std::string target_ip_;
-        struct sockaddr_in dest_addr_;
-        uint16_t packet_id_;
-        uint16_t seq_ = 0;
+        // 处理 rx_* 缓冲区里从错误队列读回的第 k 个发送时间戳，记到对应探测上
+        // 读回的是带链路层头的原始包 (链路层头长度随网卡而变)；我们的探测定长，没有 IP 选项，
+        // 所以从包尾往前数出 ICMP 头和 IP 头，再校验 IP 版本、协议号和 (id, seq)
+        void handle_tx_timestamp(size_t k)
+        {
+            const char *data = &rx_data_[k * kRxBufSize];
+            size_t n = rx_msgs_[k].msg_len;
+            struct msghdr &msg = rx_msgs_[k].msg_hdr;
+
+            const size_t kIpLen = sizeof(struct ip);
+            if ((msg.msg_flags & MSG_TRUNC) || n < kIpLen + sizeof(IcmpHeader))
+                return;
+            int64_t tx_ns = timestamp_ns(msg);
+            if (tx_ns <= 0)
+                return;
+
+            const unsigned char *ip = reinterpret_cast<const unsigned char *>(data) + n - sizeof(IcmpHeader) - kIpLen;
+            const IcmpHeader *icmp = reinterpret_cast<const IcmpHeader *>(ip + kIpLen);
+            if (ip[0] != 0x45 || ip[9] != IPPROTO_ICMP || icmp->type != 8 || ntohs(icmp->id) != packet_id_)
+                return;
 
-        // 标准网际校验和算法
-        uint16_t calculate_checksum(uint16_t *b, int len)
+            uint16_t seq = ntohs(icmp->sequence);
+            Probe &p = slot(seq);
+            if (p.in_use && p.seq == seq && p.id == packet_id_)
+                p.tx_ns = tx_ns;
+        }
+
+        // 取出 SCM_TIMESTAMPING 里的软件时间戳 (ts[0])，没有时返回 0
+        static int64_t timestamp_ns(struct msghdr &msg)
         {
-            uint32_t sum = 0;
-            while (len > 1)
+            for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c))
             {
-                sum += *b++;
-                len -= 2;
+                if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPING)
+                {
+                    struct scm_timestamping ts;
+                    std::memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+                    return static_cast<int64_t>(ts.ts[0].tv_sec) * 1000000000LL + ts.ts[0].tv_nsec;
+                }
             }
-            if (len == 1)
+            return 0;
+        }
+
+        // 经典 BPF 过滤器：只接收 "ICMP Echo Reply 且 id == packet_id_" 的包，其余在内核里丢掉，
+        // 不进接收队列也不唤醒 epoll。Raw Socket 上包从 IP 头开始：
+        //   1. 分片偏移非 0 的后续分片没有 ICMP 头，丢掉
+        //   2. X = IP 头长度 (4 * IHL)
+        //   3. ICMP type (X+0) 必须是 0，ICMP id (X+4) 必须是我们的
+        // SO_ATTACH_FILTER 会原子地替换已有的过滤器，换 ID 时直接重新挂
+        void attach_filter()
+        {
+            struct sock_filter code[] = {
+                BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 6),                 // A = flags + 分片偏移
+                BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x1fff, 6, 0),    // 非首个分片 -> drop
+                BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0),                // X = 4 * (IP[0] & 0xf)
+                BPF_STMT(BPF_LD | BPF_B | BPF_IND, 0),                 // A = ICMP type
+                BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ICMP_ECHOREPLY, 0, 3),
+                BPF_STMT(BPF_LD | BPF_H | BPF_IND, 4),                 // A = ICMP id (按网络字节序加载成主机值)
+                BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, packet_id_, 0, 1),
+                BPF_STMT(BPF_RET | BPF_K, 0xffffffff),                 // 接收整个包
+                BPF_STMT(BPF_RET | BPF_K, 0),                          // drop
+            };
+            struct sock_fprog prog;
+            prog.len = sizeof(code) / sizeof(code[0]);
+            prog.filter = code;
+            if (setsockopt(sockfd_, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0)
+                perror("setsockopt(SO_ATTACH_FILTER) failed, filtering ICMP in userspace");
+        }
+
+        // 清理超时的探测
+        // 序号按发送顺序递增，发送时间也单调，所以从最旧的序号往后扫，遇到第一个未超时的就停：
+        // 每次只扫过已结算或已超时的项，与在途总数无关
+        void expire(Clock::time_point now)
+        {
+            const Clock::duration timeout = std::chrono::milliseconds(kProbeTimeoutMs);
+            while (oldest_seq_ != seq_)
             {
-                sum += *(uint8_t *)b;
+                Probe &p = slot(oldest_seq_);
+                if (p.in_use && p.seq == oldest_seq_)
+                {
+                    if (now - p.sent_at < timeout)
+                        break;
+                    settle_lost(p);
+                }
+                ++oldest_seq_;
             }
-            sum = (sum >> 16) + (sum & 0xFFFF);
-            sum += (sum >> 16);
-            return ~sum;
+        }
+
+        void settle_lost(Probe &p)
+        {
+            p.in_use = false;
+            --in_flight_count_;
+            record_loss(targets_[p.target]);
+        }
+
+        // 记录一个探测结果：覆盖环里最旧的那一位，同时从 loss_count 里减去被覆盖的结果、加上新的，O(1)
+        // 还没写过的位是 0，环没写满时减去的也是 0
+        void push_outcome(Target &t, bool lost)
+        {
+            uint64_t &word = t.loss_ring[t.loss_pos >> 6];
+            uint64_t bit = 1ULL << (t.loss_pos & 63);
+            t.loss_count -= (word & bit) ? 1 : 0;
+            t.loss_count += lost ? 1 : 0;
+            word = lost ? (word | bit) : (word & ~bit);
+            if (++t.loss_pos == loss_window_)
+                t.loss_pos = 0;
+            if (t.loss_samples < loss_window_)
+                ++t.loss_samples;
+        }
+
+        // 窗口内的丢包率：窗口内丢包数 / 已有结果数，O(1)
+        static double loss_rate(const Target &t)
+        {
+            return t.loss_samples ? static_cast<double>(t.loss_count) / t.loss_samples : 0.0;
+        }
+
+        void fill_interface(InterfaceMetrics &metrics, double rate) const
+        {
+            metrics.rtt_ms = targets_[0].last_rtt_ms;
+            metrics.packet_loss_rate = rate;
+            metrics.packet_loss_window = loss_window_;
+            metrics.packet_loss_samples = targets_[0].loss_samples;
+        }
+
+        void record_loss(Target &t)
+        {
+            push_outcome(t, true);
+            t.last_rtt_ms = 0;
+        }
+
+        // rtt_ms: 内核时间戳算出的 RTT (没有时同 user_rtt_ms)；user_rtt_ms: 用户态测得的 RTT
+        void record_reply(Target &t, double rtt_ms, double user_rtt_ms)
+        {
+            // RFC 3550 的到达间隔抖动：J += (|D| - J) / 16，D 为相邻两次 RTT 之差
+            if (t.received > 0)
+                t.jitter_ms += (std::fabs(rtt_ms - t.last_reply_ms) - t.jitter_ms) / 16.0;
+            if (t.received == 0 || rtt_ms < t.min_ms)
+                t.min_ms = rtt_ms;
+            if (t.received == 0 || rtt_ms > t.max_ms)
+                t.max_ms = rtt_ms;
+            t.sum_ms += rtt_ms;
+            ++t.received;
+            t.last_rtt_ms = rtt_ms;
+            t.last_reply_ms = rtt_ms;
+            t.user_last_ms = user_rtt_ms;
+            t.user_sum_ms += user_rtt_ms;
+            push_outcome(t, false);
+        }
+
+        void fill(const Target &t, RttTargetMetrics &out) const
+        {
+            out.target.assign(t.name);
+            out.rtt_ms = t.last_rtt_ms;
+            out.rtt_min_ms = t.min_ms;
+            out.rtt_avg_ms = t.received ? t.sum_ms / static_cast<double>(t.received) : 0.0;
+            out.rtt_max_ms = t.max_ms;
+            out.jitter_ms = t.jitter_ms;
+            out.rtt_user_ms = t.user_last_ms;
+            out.rtt_user_avg_ms = t.received ? t.user_sum_ms / static_cast<double>(t.received) : 0.0;
+            out.loss_rate = loss_rate(t);
+            out.loss_window = loss_window_;
+            out.loss_samples = t.loss_samples;
+            out.sent = t.sent;
+            out.received = t.received;
         }
     };
 
-} // namespace flow_scope
\ No newline at end of file
+} // namespace flow_scope
@@ -0,0 +1,111 @@
+#pragma once
+#include "monitor_base.hpp"
+#include "bpf_object.hpp"
+#include <bpf/bpf.h>
+#include <unordered_map>
+#include <vector>
+
+namespace flow_scope
+{
+
+    // 基于内核 TCP 平滑 RTT 的被动 RTT 采集器
+    // BPF 侧在每个 ACK 上把 srtt_us 计入每网卡的 log2 直方图，
+    // 这里每个周期取一次差分，算出本周期的 p50/p90/p99，全程不发送任何探测包
+    class TcpRttMonitor : public MonitorBase
+    {
+    public:
+        explicit TcpRttMonitor(BpfObject &bpf) : skel_(bpf.skel())
+        {
+            if (!skel_ || !bpf.tcp_rcv_loaded())
+            {
+                // 内核不支持 fentry 时程序未加载，直方图始终为空
+                skel_ = nullptr;
+                return;
+            }
+            percpu_hist_.resize(bpf.ncpus());
+        }
+
+        void collect(InterfaceMetrics &metrics) override
+        {
+            metrics.tcp_rtt_p50_ms = 0;
+            metrics.tcp_rtt_p90_ms = 0;
+            metrics.tcp_rtt_p99_ms = 0;
+            metrics.tcp_rtt_samples = 0;
+
+            if (!skel_)
+                return;
+
+            uint32_t ifindex = metrics.ifindex;
+            if (ifindex == 0)
+                return;
+
+            // 1. 读取所有 CPU 的直方图并求和
+            int map_fd = bpf_map__fd(skel_->maps.tcp_rtt_hist);
+            if (bpf_map_lookup_elem(map_fd, &ifindex, percpu_hist_.data()) != 0)
+                return; // 该网卡还没有 RTT 样本
+
+            rtt_hist cur = {};
+            for (const auto &h : percpu_hist_)
+                for (int i = 0; i < RTT_SLOTS; ++i)
+                    cur.slots[i] += h.slots[i];
+
+            // 2. 与上一周期做差分，得到本周期的直方图
+            // 条目被 LRU 淘汰后重建时计数会变小，此时直接使用当前值
+            rtt_hist &prev = last_hist_[ifindex];
+            rtt_hist delta;
+            uint64_t total = 0;
+            for (int i = 0; i < RTT_SLOTS; ++i)
+            {
+                delta.slots[i] = cur.slots[i] >= prev.slots[i] ? cur.slots[i] - prev.slots[i] : cur.slots[i];
+                total += delta.slots[i];
+            }
+            prev = cur;
+
+            if (total == 0)
+                return;
+
+            // 3. 计算分位数
+            metrics.tcp_rtt_samples = total;
+            metrics.tcp_rtt_p50_ms = percentile_us(delta, total, 0.50) / 1000.0;
+            metrics.tcp_rtt_p90_ms = percentile_us(delta, total, 0.90) / 1000.0;
+            metrics.tcp_rtt_p99_ms = percentile_us(delta, total, 0.99) / 1000.0;
+        }
+
+        void on_interface_removed(uint32_t ifindex, const std::string &) override
+        {
+            last_hist_.erase(ifindex);
+        }
+
+    private:
+        // Skeleton 由 BpfObject 拥有
+        struct tcp_loss_bpf *skel_ = nullptr;
+
+        // Per-CPU 直方图读取缓冲区，构造时按 possible CPU 数量分配一次
+        std::vector<rtt_hist> percpu_hist_;
+
+        // 每个 ifindex 上一周期的累计直方图
+        std::unordered_map<uint32_t, rtt_hist> last_hist_;
+
+        // 在 log2 桶内做线性插值：槽位 i 覆盖 [2^i, 2^(i+1)) 微秒
+        static double percentile_us(const rtt_hist &hist, uint64_t total, double p)
+        {
+            double target = p * static_cast<double>(total);
+            uint64_t cum = 0;
+            for (int i = 0; i < RTT_SLOTS; ++i)
+            {
+                uint64_t n = hist.slots[i];
+                if (n == 0)
+                    continue;
+                if (static_cast<double>(cum + n) >= target)
+                {
+                    double lo = static_cast<double>(1ULL << i);
+                    double frac = (target - static_cast<double>(cum)) / static_cast<double>(n);
+                    return lo + frac * lo; // 桶宽等于下界
+                }
+                cum += n;
+            }
+            return static_cast<double>(1ULL << RTT_SLOTS);
+        }
+    };
+
+} // namespace flow_scope
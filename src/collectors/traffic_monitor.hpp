@@ -1,78 +1,50 @@
 #pragma once
 #include "monitor_base.hpp"
-#include <fstream>
-#include <sstream>
+#include "proc_net_dev.hpp"
+#include "netlink_link_stats.hpp"
+#include <memory>
 #include <unordered_map>
 #include <chrono>
 
 namespace flow_scope
 {
 
+    // 网卡计数器的数据源，启动时选定
+    enum class TrafficBackend
+    {
+        Procfs,  // 解析 /proc/net/dev 文本
+        Netlink, // RTM_GETLINK dump，直接读取 rtnl_link_stats64
+    };
+
     class TrafficMonitor : public MonitorBase
     {
     public:
-        TrafficMonitor()
+        explicit TrafficMonitor(TrafficBackend backend = TrafficBackend::Procfs)
         {
-            last_check_time_ = std::chrono::steady_clock::now();
+            if (backend == TrafficBackend::Netlink)
+                reader_ = std::make_unique<NetlinkLinkStatsReader>();
+            else
+                reader_ = std::make_unique<ProcNetDevReader>();
         }
 
-        void collect(InterfaceMetrics &metrics) override
+        // 每个周期只读取一次数据源 (一次遍历解析出所有网卡)，然后逐个网卡在结果表里查找
+        void collect_all(SystemSnapshot &snapshot) override
         {
-            std::ifstream file("/proc/net/dev");
-            std::string line;
-
-            // 1. 跳过前两行表头
-            std::getline(file, line);
-            std::getline(file, line);
-
-            bool found = false;
+            refresh();
+            for (auto &metrics : snapshot.interfaces)
+                lookup(metrics);
+        }
 
-            // 2. 逐行读取
-            while (std::getline(file, line))
-            {
-                // 格式通常是: "  eth0: 12345 ..." 或 "eth0:12345..."
-                // 我们需要找到匹配 metrics.name 的那一行
-
-                // 简单的字符串查找（生产环境可以用更严谨的解析）
-                size_t colon_pos = line.find(':');
-                if (colon_pos == std::string::npos)
-                    continue;
-
-                std::string iface_name = line.substr(0, colon_pos);
-                // 去除名称前的空格
-                iface_name.erase(0, iface_name.find_first_not_of(" "));
-
-                if (iface_name == metrics.name)
-                {
-                    // 找到目标网卡
-                    std::string stats = line.substr(colon_pos + 1);
-                    std::stringstream ss(stats);
-
-                    uint64_t rx_bytes = 0;
-                    uint64_t tx_bytes = 0;
-                    uint64_t temp = 0;
-
-                    // /proc/net/dev 的列顺序：
-                    // Rx: bytes packets errs drop fifo frame compressed multicast
-                    // Tx: bytes ...
-
-                    ss >> rx_bytes; // 第1列: rx_bytes
-                    for (int i = 0; i < 7; ++i)
-                        ss >> temp; // 跳过中间7列
-                    ss >> tx_bytes; // 第9列: tx_bytes (即 Tx 部分的第1列)
-
-                    calculate_rate(metrics, rx_bytes, tx_bytes);
-                    found = true;
-                    break;
-                }
-            }
+        // 单网卡入口：同样会重新读取数据源，批量场景请用 collect_all
+        void collect(InterfaceMetrics &metrics) override
+        {
+            refresh();
+            lookup(metrics);
+        }
 
-            if (!found)
-            {
-                // 如果没找到网卡（比如网卡名写错了），归零
-                metrics.rx_bps = 0;
-                metrics.tx_bps = 0;
-            }
+        void on_interface_removed(uint32_t, const std::string &name) override
+        {
+            last_stats_.erase(name);
         }
 
     private:
@@ -80,22 +52,47 @@ namespace flow_scope
         {
             uint64_t rx_bytes = 0;
             uint64_t tx_bytes = 0;
+            std::chrono::steady_clock::time_point time;
+            size_t hint = 0; // 上次在 reader_ 结果表中的位置
         };
 
+        std::unique_ptr<LinkStatsReader> reader_;
+        bool valid_ = false;
+        std::chrono::steady_clock::time_point read_time_;
+
         std::unordered_map<std::string, LastState> last_stats_;
-        std::chrono::steady_clock::time_point last_check_time_;
 
-        void calculate_rate(InterfaceMetrics &metrics, uint64_t current_rx, uint64_t current_tx)
+        void refresh()
+        {
+            valid_ = reader_->read();
+            read_time_ = std::chrono::steady_clock::now();
+        }
+
+        void lookup(InterfaceMetrics &metrics)
+        {
+            // 稳态下 name 对应的条目已存在，不会分配
+            LastState &last = last_stats_[metrics.name];
+
+            const LinkStats *link = valid_ ? reader_->find(metrics.name, last.hint) : nullptr;
+            if (!link)
+            {
+                // 如果没找到网卡（比如网卡名写错了），归零
+                metrics.rx_bps = 0;
+                metrics.tx_bps = 0;
+                return;
+            }
+
+            calculate_rate(metrics, last, link->cols[LinkStats::RX_BYTES], link->cols[LinkStats::TX_BYTES]);
+        }
+
+        void calculate_rate(InterfaceMetrics &metrics, LastState &last, uint64_t current_rx, uint64_t current_tx)
         {
-            auto now = std::chrono::steady_clock::now();
+            // 每个网卡单独记录上次的读取时间
             // 计算时间差 (秒)，防止除以0
-            double seconds = std::chrono::duration<double>(now - last_check_time_).count();
+            double seconds = std::chrono::duration<double>(read_time_ - last.time).count();
             if (seconds <= 0.0001)
                 seconds = 1.0;
 
-            // 获取上一次的状态
-            LastState &last = last_stats_[metrics.name];
-
             // 计算速率 (Bytes / Second)
             // 注意：首次运行时 last 默认为0，速率会很大，这里简单处理一下
             if (last.rx_bytes != 0)
@@ -113,12 +110,8 @@ namespace flow_scope
             // 更新状态
             last.rx_bytes = current_rx;
             last.tx_bytes = current_tx;
-
-            // 注意：这里简单的将 last_check_time 更新为 now
-            // 在多网卡循环中，应该对每个网卡单独记录时间，或者保证 collect 调用间隔一致。
-            // 为了演示简单，我们假设 collect 是一次性调用完所有网卡的。
-            // *更严谨的做法*：将 last_check_time 放入 LastState 结构体中。
+            last.time = read_time_;
         }
     };
 
-} // namespace flow_scope
\ No newline at end of file
+} // namespace flow_scope
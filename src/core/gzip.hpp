@@ -0,0 +1,59 @@
+#pragma once
+#include <zlib.h>
+#include <cstdio>
+#include <string>
+
+namespace flow_scope
+{
+
+    // gzip 压缩器 (zlib deflate + gzip 头)
+    // z_stream 只初始化一次，之后每次 deflateReset 复用内部状态；输出写入调用者复用的 std::string
+    class GzipCompressor
+    {
+    public:
+        explicit GzipCompressor(int level = Z_DEFAULT_COMPRESSION)
+        {
+            // windowBits 15 + 16: 输出带 gzip 头和尾的格式，而不是裸 zlib 流
+            ok_ = deflateInit2(&zs_, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+            if (!ok_)
+                std::fprintf(stderr, "deflateInit2 failed\n");
+        }
+
+        ~GzipCompressor()
+        {
+            if (ok_)
+                deflateEnd(&zs_);
+        }
+
+        GzipCompressor(const GzipCompressor &) = delete;
+        GzipCompressor &operator=(const GzipCompressor &) = delete;
+
+        // 把 in 整体压缩到 out (覆盖原内容)，失败返回 false
+        bool compress(const std::string &in, std::string &out)
+        {
+            if (!ok_ || deflateReset(&zs_) != Z_OK)
+                return false;
+
+            // deflateBound 是一次性压缩的上界，按它扩容后一次 deflate 就能完成
+            out.resize(deflateBound(&zs_, static_cast<uLong>(in.size())));
+
+            zs_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in.data()));
+            zs_.avail_in = static_cast<uInt>(in.size());
+            zs_.next_out = reinterpret_cast<Bytef *>(&out[0]);
+            zs_.avail_out = static_cast<uInt>(out.size());
+
+            if (deflate(&zs_, Z_FINISH) != Z_STREAM_END)
+            {
+                out.clear();
+                return false;
+            }
+            out.resize(zs_.total_out);
+            return true;
+        }
+
+    private:
+        z_stream zs_ = {};
+        bool ok_ = false;
+    };
+
+} // namespace flow_scope
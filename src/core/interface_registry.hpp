@@ -0,0 +1,304 @@
+#pragma once
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "scheduler.hpp"
+
+namespace flow_scope
+{
+
+    struct InterfaceInfo
+    {
+        uint32_t ifindex = 0;
+        std::string name;
+    };
+
+    // 实时网卡表 (ifindex -> 网卡)
+    // 启动时 dump 一次，之后订阅 RTNLGRP_LINK，通过 Scheduler 的 epoll 增量处理网卡的增删改，
+    // 容器主机上 veth 频繁创建/销毁也不需要重新扫描或重启
+    class InterfaceRegistry
+    {
+    public:
+        using Listener = std::function<void(const InterfaceInfo &)>;
+
+        // include 为空表示全部包含；exclude 优先于 include。模式语法同 shell 通配符 (fnmatch)
+        InterfaceRegistry(std::vector<std::string> include, std::vector<std::string> exclude)
+            : include_(std::move(include)), exclude_(std::move(exclude))
+        {
+            buf_.resize(64 * 1024);
+        }
+
+        ~InterfaceRegistry()
+        {
+            if (fd_ >= 0)
+                close(fd_);
+        }
+
+        InterfaceRegistry(const InterfaceRegistry &) = delete;
+        InterfaceRegistry &operator=(const InterfaceRegistry &) = delete;
+
+        // 网卡被移除 (或改名后不再匹配) 时回调，供采集器清理各自的状态
+        void on_removed(Listener listener) { removed_listeners_.push_back(std::move(listener)); }
+
+        // 订阅链路事件并做一次全量同步，然后把 socket 挂到 epoll 上
+        bool start(Scheduler &scheduler)
+        {
+            fd_ = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+            if (fd_ < 0)
+            {
+                perror("socket(NETLINK_ROUTE) failed");
+                return false;
+            }
+
+            // 先订阅再 dump，保证 dump 期间发生的变化不会丢
+            struct sockaddr_nl addr = {};
+            addr.nl_family = AF_NETLINK;
+            addr.nl_groups = RTMGRP_LINK;
+            if (bind(fd_, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+            {
+                perror("bind(RTMGRP_LINK) failed");
+                close(fd_);
+                fd_ = -1;
+                return false;
+            }
+
+            if (!resync())
+                return false;
+
+            fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) | O_NONBLOCK);
+            scheduler.add_io_task(fd_, [this]()
+                                  { handle_events(); });
+            return true;
+        }
+
+        // 当前匹配过滤条件的网卡 (顺序不固定)
+        const std::vector<InterfaceInfo> &interfaces() const { return interfaces_; }
+
+        // 每次网卡表发生变化时递增
+        uint64_t version() const { return version_; }
+
+    private:
+        int fd_ = -1;
+        uint32_t seq_ = 0;
+        std::vector<char> buf_;
+
+        std::vector<std::string> include_;
+        std::vector<std::string> exclude_;
+
+        std::vector<InterfaceInfo> interfaces_;
+        std::unordered_map<uint32_t, size_t> index_; // ifindex -> interfaces_ 下标
+        uint64_t version_ = 0;
+
+        std::vector<Listener> removed_listeners_;
+
+        bool matches(const char *name) const
+        {
+            for (const auto &pattern : exclude_)
+                if (fnmatch(pattern.c_str(), name, 0) == 0)
+                    return false;
+            if (include_.empty())
+                return true;
+            for (const auto &pattern : include_)
+                if (fnmatch(pattern.c_str(), name, 0) == 0)
+                    return true;
+            return false;
+        }
+
+        // 全量 dump 一次 (启动时，以及事件队列溢出后)
+        bool resync()
+        {
+            // dump 期间临时切回阻塞模式，读完再恢复
+            int flags = fcntl(fd_, F_GETFL);
+            fcntl(fd_, F_SETFL, flags & ~O_NONBLOCK);
+            bool ok = dump_all();
+            fcntl(fd_, F_SETFL, flags);
+            return ok;
+        }
+
+        bool dump_all()
+        {
+            struct
+            {
+                struct nlmsghdr nlh;
+                struct ifinfomsg ifm;
+            } req = {};
+            req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+            req.nlh.nlmsg_type = RTM_GETLINK;
+            req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+            req.nlh.nlmsg_seq = ++seq_;
+            req.ifm.ifi_family = AF_UNSPEC;
+
+            if (send(fd_, &req, req.nlh.nlmsg_len, 0) < 0)
+            {
+                perror("send(RTM_GETLINK) failed");
+                return false;
+            }
+
+            // dump 结果与期间的事件混在一起读取，都按同样的方式处理 (幂等)
+            // dump 和事件里都没出现过的网卡视为已删除
+            std::unordered_map<uint32_t, bool> seen;
+            bool done = false;
+            while (!done)
+            {
+                ssize_t n = recv(fd_, buf_.data(), buf_.size(), 0);
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    if (errno == ENOBUFS)
+                        continue; // 事件溢出，dump 本身仍会继续
+                    perror("recv(RTM_GETLINK) failed");
+                    return false;
+                }
+
+                int len = static_cast<int>(n);
+                for (auto *nlh = reinterpret_cast<struct nlmsghdr *>(buf_.data()); NLMSG_OK(nlh, len);
+                     nlh = NLMSG_NEXT(nlh, len))
+                {
+                    if (nlh->nlmsg_type == NLMSG_DONE && nlh->nlmsg_seq == seq_)
+                    {
+                        done = true;
+                        break;
+                    }
+                    if (nlh->nlmsg_type == NLMSG_ERROR && nlh->nlmsg_seq == seq_)
+                    {
+                        std::cerr << "RTM_GETLINK dump returned error" << std::endl;
+                        return false;
+                    }
+                    uint32_t ifindex = handle_message(nlh);
+                    if (ifindex)
+                        seen[ifindex] = true;
+                }
+            }
+
+            // 清理 dump 中没有出现的网卡
+            for (size_t i = 0; i < interfaces_.size();)
+            {
+                if (seen.count(interfaces_[i].ifindex) == 0)
+                    remove(interfaces_[i].ifindex);
+                else
+                    ++i;
+            }
+            return true;
+        }
+
+        // epoll 回调：读完所有待处理的链路事件
+        void handle_events()
+        {
+            while (true)
+            {
+                ssize_t n = recv(fd_, buf_.data(), buf_.size(), 0);
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    if (errno == ENOBUFS)
+                    {
+                        // 事件太多，socket 缓冲区溢出，只能全量同步一次
+                        std::cerr << "Link event queue overflowed, resyncing" << std::endl;
+                        resync();
+                        continue;
+                    }
+                    // EAGAIN: 读完了
+                    return;
+                }
+
+                int len = static_cast<int>(n);
+                for (auto *nlh = reinterpret_cast<struct nlmsghdr *>(buf_.data()); NLMSG_OK(nlh, len);
+                     nlh = NLMSG_NEXT(nlh, len))
+                {
+                    handle_message(nlh);
+                }
+            }
+        }
+
+        // 处理一条 RTM_NEWLINK / RTM_DELLINK，返回涉及的 ifindex (其它消息返回 0)
+        uint32_t handle_message(struct nlmsghdr *nlh)
+        {
+            if (nlh->nlmsg_type != RTM_NEWLINK && nlh->nlmsg_type != RTM_DELLINK)
+                return 0;
+
+            auto *ifm = static_cast<struct ifinfomsg *>(NLMSG_DATA(nlh));
+            // 网桥端口的通知 (AF_BRIDGE) 也发到 RTNLGRP_LINK，例如 `ip link set X nomaster` 会产生一条
+            // AF_BRIDGE 的 RTM_DELLINK，而网卡本身仍然存在；只有 AF_UNSPEC 的消息描述网卡本身
+            if (ifm->ifi_family != AF_UNSPEC)
+                return 0;
+            uint32_t ifindex = static_cast<uint32_t>(ifm->ifi_index);
+
+            if (nlh->nlmsg_type == RTM_DELLINK)
+            {
+                remove(ifindex);
+                return ifindex;
+            }
+
+            const char *name = nullptr;
+            int attr_len = static_cast<int>(IFLA_PAYLOAD(nlh));
+            for (struct rtattr *rta = IFLA_RTA(ifm); RTA_OK(rta, attr_len); rta = RTA_NEXT(rta, attr_len))
+            {
+                if (rta->rta_type == IFLA_IFNAME)
+                {
+                    name = static_cast<const char *>(RTA_DATA(rta));
+                    break;
+                }
+            }
+            if (!name)
+                return ifindex;
+
+            auto it = index_.find(ifindex);
+            if (it != index_.end())
+            {
+                // 已知网卡：名字没变就什么都不做 (RTM_NEWLINK 也用于状态变化通知)
+                if (interfaces_[it->second].name == name)
+                    return ifindex;
+                // 改名：按 "删除旧名 + 添加新名" 处理，采集器按名字维护的状态随之重建
+                remove(ifindex);
+            }
+
+            if (matches(name))
+            {
+                index_[ifindex] = interfaces_.size();
+                interfaces_.push_back({ifindex, name});
+                ++version_;
+                std::cout << "Interface added: " << name << " (ifindex " << ifindex << ")" << std::endl;
+            }
+            return ifindex;
+        }
+
+        void remove(uint32_t ifindex)
+        {
+            auto it = index_.find(ifindex);
+            if (it == index_.end())
+                return;
+
+            size_t pos = it->second;
+            InterfaceInfo removed = std::move(interfaces_[pos]);
+            index_.erase(it);
+
+            // 与末尾交换后删除，O(1)
+            if (pos != interfaces_.size() - 1)
+            {
+                interfaces_[pos] = std::move(interfaces_.back());
+                index_[interfaces_[pos].ifindex] = pos;
+            }
+            interfaces_.pop_back();
+            ++version_;
+
+            std::cout << "Interface removed: " << removed.name << " (ifindex " << ifindex << ")" << std::endl;
+            for (auto &listener : removed_listeners_)
+                listener(removed);
+        }
+    };
+
+} // namespace flow_scope
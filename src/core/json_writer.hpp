@@ -0,0 +1,239 @@
+#pragma once
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include "text_writer.hpp"
+
+namespace flow_scope
+{
+
+    // 流式 JSON 写入器：直接追加到调用者复用的 std::string，不构建 DOM
+    // 输出与 nlohmann::json::dump() 的紧凑格式一致，前提是调用者按字母序写对象的键 (nlohmann 的对象是 std::map)。
+    // 唯一的差别在 double 的数字串：这里用 std::to_chars 的真正最短表示，nlohmann 的 Grisu2 偶尔会多一位或末位不同，
+    // 两者解析回来的值相同。逗号由写入器自动补，嵌套深度不超过 kMaxDepth
+    class JsonWriter
+    {
+    public:
+        explicit JsonWriter(std::string &out) : out_(out), w_(out) {}
+
+        void clear()
+        {
+            out_.clear();
+            depth_ = 0;
+            first_[0] = true;
+        }
+
+        JsonWriter &begin_object() { return open('{'); }
+        JsonWriter &end_object() { return close('}'); }
+        JsonWriter &begin_array() { return open('['); }
+        JsonWriter &end_array() { return close(']'); }
+
+        // 写入键，下一个值不再补逗号
+        JsonWriter &key(std::string_view k)
+        {
+            separator();
+            put_string(k);
+            out_.push_back(':');
+            after_key_ = true;
+            return *this;
+        }
+
+        JsonWriter &value(std::string_view s)
+        {
+            separator();
+            put_string(s);
+            return *this;
+        }
+
+        JsonWriter &value(const char *s) { return value(std::string_view(s)); }
+
+        JsonWriter &value(uint64_t v)
+        {
+            separator();
+            w_.put_u64(v);
+            return *this;
+        }
+
+        JsonWriter &value(uint32_t v) { return value(static_cast<uint64_t>(v)); }
+        JsonWriter &value(uint16_t v) { return value(static_cast<uint64_t>(v)); }
+
+        // 与 nlohmann 相同的排版：最短往返的十进制数字，指数在 (-4, 15] 内用定点表示，
+        // 整数值补 ".0"，否则写成 d.ddde+XX；NaN / Inf 写成 null
+        JsonWriter &value(double v)
+        {
+            separator();
+            if (!std::isfinite(v))
+            {
+                out_.append("null", 4);
+                return *this;
+            }
+            if (std::signbit(v))
+            {
+                out_.push_back('-');
+                v = -v;
+            }
+            if (v == 0)
+            {
+                out_.append("0.0", 3);
+                return *this;
+            }
+
+            // to_chars 的 scientific 最短表示: "d[.ddd]e[+-]XX"，拆成数字串和十进制指数
+            char sci[32];
+            auto r = std::to_chars(sci, sci + sizeof(sci), v, std::chars_format::scientific);
+            char digits[24];
+            int k = 0;
+            const char *p = sci;
+            for (; p < r.ptr && *p != 'e'; ++p)
+                if (*p != '.')
+                    digits[k++] = *p;
+            int exp10 = 0;
+            ++p; // 跳过 'e'
+            if (p < r.ptr && *p == '+')
+                ++p; // from_chars 不接受正号
+            std::from_chars(p, r.ptr, exp10);
+            int n = exp10 + 1; // 小数点相对数字串开头的位置
+
+            char buf[48];
+            char *b = buf;
+            if (k <= n && n <= kMaxExp)
+            {
+                // digits[000].0
+                std::memcpy(b, digits, k);
+                std::memset(b + k, '0', n - k);
+                b += n;
+                *b++ = '.';
+                *b++ = '0';
+            }
+            else if (0 < n && n <= kMaxExp)
+            {
+                // dig.its
+                std::memcpy(b, digits, n);
+                b += n;
+                *b++ = '.';
+                std::memcpy(b, digits + n, k - n);
+                b += k - n;
+            }
+            else if (kMinExp < n && n <= 0)
+            {
+                // 0.[000]digits
+                *b++ = '0';
+                *b++ = '.';
+                std::memset(b, '0', -n);
+                b += -n;
+                std::memcpy(b, digits, k);
+                b += k;
+            }
+            else
+            {
+                // d[.igits]e+XX
+                *b++ = digits[0];
+                if (k > 1)
+                {
+                    *b++ = '.';
+                    std::memcpy(b, digits + 1, k - 1);
+                    b += k - 1;
+                }
+                *b++ = 'e';
+                int e = n - 1;
+                *b++ = e < 0 ? '-' : '+';
+                if (e < 0)
+                    e = -e;
+                if (e < 10)
+                    *b++ = '0';
+                b = std::to_chars(b, buf + sizeof(buf), e).ptr;
+            }
+            out_.append(buf, static_cast<size_t>(b - buf));
+            return *this;
+        }
+
+    private:
+        static constexpr int kMaxDepth = 16;
+        static constexpr int kMinExp = -4;
+        static constexpr int kMaxExp = 15; // std::numeric_limits<double>::digits10
+
+        std::string &out_;
+        TextWriter w_;
+        int depth_ = 0;
+        bool first_[kMaxDepth + 1] = {true};
+        bool after_key_ = false;
+
+        void separator()
+        {
+            if (after_key_)
+            {
+                after_key_ = false;
+                return;
+            }
+            if (!first_[depth_])
+                out_.push_back(',');
+            first_[depth_] = false;
+        }
+
+        JsonWriter &open(char c)
+        {
+            separator();
+            out_.push_back(c);
+            first_[++depth_] = true;
+            return *this;
+        }
+
+        JsonWriter &close(char c)
+        {
+            out_.push_back(c);
+            --depth_;
+            return *this;
+        }
+
+        // 转义规则同 nlohmann (ensure_ascii = false)：只转义引号、反斜杠和控制字符
+        void put_string(std::string_view s)
+        {
+            static const char kHex[] = "0123456789abcdef";
+            out_.push_back('"');
+            for (char ch : s)
+            {
+                unsigned char c = static_cast<unsigned char>(ch);
+                switch (c)
+                {
+                case '"':
+                    out_.append("\\\"", 2);
+                    break;
+                case '\\':
+                    out_.append("\\\\", 2);
+                    break;
+                case '\b':
+                    out_.append("\\b", 2);
+                    break;
+                case '\f':
+                    out_.append("\\f", 2);
+                    break;
+                case '\n':
+                    out_.append("\\n", 2);
+                    break;
+                case '\r':
+                    out_.append("\\r", 2);
+                    break;
+                case '\t':
+                    out_.append("\\t", 2);
+                    break;
+                default:
+                    if (c < 0x20)
+                    {
+                        char esc[6] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xF]};
+                        out_.append(esc, 6);
+                    }
+                    else
+                    {
+                        out_.push_back(ch);
+                    }
+                    break;
+                }
+            }
+            out_.push_back('"');
+        }
+    };
+
+} // namespace flow_scope
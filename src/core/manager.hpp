@@ -1,15 +1,97 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <mutex>
-#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include "gzip.hpp"
 #include "metrics.hpp"
+#include "snapshot_encoder.hpp"
+#include "snapshot_stream.hpp"
 
 namespace flow_scope
 {
 
+    // 每一代快照预先序列化好的格式
+    enum class SnapshotFormat : uint32_t
+    {
+        Json,       // GET /metrics
+        Prometheus, // GET /metrics/prometheus
+        Binary,     // GET /metrics/binary (见 snapshot_decoder.hpp)
+        Count,
+    };
+
+    // 快照发布器：三缓冲 + 读者计数
+    //
+    // - 读者 (HTTP 线程) 获取快照只有一次 fetch_add，释放只有一次 fetch_add，没有循环和锁，wait-free
+    // - 写者 (采集线程) 只在三个预分配的槽位之间轮转，不分配内存
+    // - 还有读者持有的槽位绝不会被写者 reset 或改写，读者看到的一定是完整的一代数据
+    //
+    // 计数方式：当前前台槽位的下标和"获取次数"打包在同一个 64 位原子变量里 (高 32 位下标，低 32 位计数)，
+    // 读者 fetch_add(1) 一次就同时拿到了下标并登记了自己。发布时写者用 exchange 换入新下标并把计数清零，
+    // 换出来的计数就是旧槽位被获取的总次数；读者释放时累加到槽位自己的 released 上，两者相等即说明没有读者了。
     class Manager
     {
     public:
+        static constexpr uint32_t kSlots = 3;
+
+        // 读者持有的快照引用，析构时自动释放，只能移动不能拷贝
+        class SnapshotRef
+        {
+        public:
+            SnapshotRef() = default;
+            SnapshotRef(SnapshotRef &&other) noexcept : mgr_(other.mgr_), slot_(other.slot_) { other.mgr_ = nullptr; }
+            SnapshotRef &operator=(SnapshotRef &&other) noexcept
+            {
+                if (this != &other)
+                {
+                    release();
+                    mgr_ = other.mgr_;
+                    slot_ = other.slot_;
+                    other.mgr_ = nullptr;
+                }
+                return *this;
+            }
+            SnapshotRef(const SnapshotRef &) = delete;
+            SnapshotRef &operator=(const SnapshotRef &) = delete;
+            ~SnapshotRef() { release(); }
+
+            const SystemSnapshot *operator->() const { return &mgr_->slots_[slot_].data; }
+            const SystemSnapshot &operator*() const { return mgr_->slots_[slot_].data; }
+            explicit operator bool() const { return mgr_ != nullptr; }
+
+            // 发布时已序列化好的响应体，同一代的所有请求共享这一份
+            // 返回共享指针而不是引用：响应可以在释放快照之后慢慢发送，慢客户端不会拖住写者
+            std::shared_ptr<const std::string> body(SnapshotFormat format) const
+            {
+                return mgr_->slots_[slot_].bodies[index(format)];
+            }
+
+            // 同一份响应体的 gzip 版本，压缩失败时返回空指针
+            // 每一代每个格式只在第一个要 gzip 的请求里压缩一次 (并发的请求等它完成)，之后同一代共用
+            std::shared_ptr<const std::string> gzip(SnapshotFormat format) const
+            {
+                return mgr_->gzip_once(mgr_->slots_[slot_], index(format));
+            }
+
+        private:
+            friend class Manager;
+            SnapshotRef(Manager *mgr, uint32_t slot) : mgr_(mgr), slot_(slot) {}
+
+            void release()
+            {
+                if (mgr_)
+                    mgr_->slots_[slot_].released.fetch_add(1, std::memory_order_release);
+                mgr_ = nullptr;
+            }
+
+            Manager *mgr_ = nullptr;
+            uint32_t slot_ = 0;
+        };
+
         static Manager &get_instance()
         {
             static Manager instance;
@@ -17,57 +99,176 @@ namespace flow_scope
         }
 
         // --- 读者接口 (HTTP 线程) ---
-        // 返回当前“前台”数据的只读引用，完全无锁
-        std::shared_ptr<const SystemSnapshot> get_snapshot() const
+        // 获取当前前台快照，持有期间该槽位不会被改写
+        SnapshotRef get_snapshot()
+        {
+            uint64_t state = state_.fetch_add(1, std::memory_order_acquire);
+            return SnapshotRef(this, static_cast<uint32_t>(state >> 32));
+        }
+
+        // 当前前台快照的发布序号 (一次原子读取)，用于条件请求：客户端手里已经是这一代就不必取快照
+        uint64_t generation() const
         {
-            // 原子读取 shared_ptr (C++11/17 方式)
-            // load 操作非常快，几乎无开销
-            return std::atomic_load(&active_snapshot_);
+            return generation_.load(std::memory_order_acquire);
         }
 
-        // --- 写者接口 (采集线程) ---
-        // 获取“后台”缓冲区的引用，用于写入数据
+        // 本进程的标识 (启动时随机生成，之后不变)，和发布序号一起区分不同进程发布的同号代
+        uint64_t epoch() const { return epoch_; }
+
+        // 发布推送 (SSE 订阅者)
+        SnapshotStream &stream() { return stream_; }
+
+        // --- 写者接口 (采集线程，只允许一个写者) ---
+        // 获取“后台”缓冲区，用于写入数据
         SystemSnapshot *get_background_buffer()
         {
-            return background_buffer_.get();
+            return &slots_[background_].data;
         }
 
-        // 提交数据：将后台切换为前台
+        // 提交数据：后台切换为前台，再挑一个已经没有读者的槽位作为下一个后台
         void publish_snapshot()
         {
-            // 1. 准备要交换的指针
-            std::shared_ptr<SystemSnapshot> new_active = background_buffer_;
+            // 0. 编号，然后每种格式各序列化一次，之后这一代的请求都直接使用
+            uint64_t generation = generation_.load(std::memory_order_relaxed) + 1;
+            slots_[background_].data.generation = generation;
+            render(slots_[background_]);
 
-            // 2. 原子交换 (Exchange)
-            // active_snapshot_ 变成新的数据
-            // old_active 拿到旧的数据 (即现在的后台)
-            std::shared_ptr<SystemSnapshot> old_active = std::atomic_exchange(&active_snapshot_, new_active);
+            // 1. 换入新的前台，同时取回旧前台被获取的次数
+            uint64_t old = state_.exchange(static_cast<uint64_t>(background_) << 32, std::memory_order_acq_rel);
+            uint32_t old_slot = static_cast<uint32_t>(old >> 32);
+            slots_[old_slot].acquired += old & 0xFFFFFFFFu;
+            generation_.store(generation, std::memory_order_release);
 
-            // 3. 将旧的前台数据回收，作为下一次的后台缓冲区
-            // 这样我们就实现了 0 内存分配 (Zero Allocation)
-            background_buffer_ = old_active;
+            // 推送给订阅者 (只入队，不等待发送)
+            stream_.publish(generation, slots_[background_].bodies[index(SnapshotFormat::Json)]);
 
-            // 4. 重置后台数据，准备下一次采集
-            background_buffer_->reset();
+            // 2. 找一个读者已经全部释放的非前台槽位
+            // 三个槽位里除了新前台还有两个，只有两代之前的读者都还没放手时才需要等
+            uint32_t active = background_;
+            while (true)
+            {
+                for (uint32_t i = 1; i < kSlots; ++i)
+                {
+                    uint32_t candidate = (active + i) % kSlots;
+                    if (drained(candidate))
+                    {
+                        background_ = candidate;
+                        // 3. 重置后台数据，准备下一次采集
+                        slots_[background_].data.reset();
+                        return;
+                    }
+                }
+                std::this_thread::yield();
+            }
         }
 
     private:
+        // 每个槽位独占缓存行，读者释放时互不干扰
+        static constexpr size_t kFormats = static_cast<size_t>(SnapshotFormat::Count);
+
+        // Slot::gzip_state 的取值
+        static constexpr uint32_t kGzipEmpty = 0;    // 这一代还没人要过 gzip
+        static constexpr uint32_t kGzipBusy = 1;     // 某个读者正在压缩
+        static constexpr uint32_t kGzipReady = 2;    // gzip[] 对应这一代
+        static constexpr uint32_t kGzipFailed = 3;
+
+        static constexpr size_t index(SnapshotFormat format) { return static_cast<size_t>(format); }
+
+        struct alignas(64) Slot
+        {
+            SystemSnapshot data;
+            uint64_t acquired = 0;                         // 离开前台时累计的获取次数，只有写者访问
+            alignas(64) std::atomic<uint64_t> released{0}; // 读者释放次数，单调递增，与快照数据分开缓存行
+            std::shared_ptr<std::string> bodies[kFormats]; // data 的各格式序列化结果
+            std::shared_ptr<std::string> gzip[kFormats];   // bodies 的 gzip 版本 (缓冲区保留以便复用)
+            std::atomic<uint32_t> gzip_state[kFormats] = {}; // kGzip*，写者在槽位进入前台前置为 kGzipEmpty
+        };
+
+        // 槽位 0 为初始前台 (空快照)，槽位 1 为初始后台
         Manager()
         {
-            // 初始化两个缓冲区
-            auto s1 = std::make_shared<SystemSnapshot>();
-            auto s2 = std::make_shared<SystemSnapshot>();
+            std::random_device rd;
+            epoch_ = (static_cast<uint64_t>(rd()) << 32) ^ rd() ^
+                     static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+            render(slots_[0]);
+        }
+
+        // 把槽位的快照序列化到它自己的各格式缓冲区
+        void render(Slot &slot)
+        {
+            slot.data.to_json(*writable(slot.bodies[index(SnapshotFormat::Json)]));
+            slot.data.to_prometheus(*writable(slot.bodies[index(SnapshotFormat::Prometheus)]));
+            encoder_.encode(slot.data, *writable(slot.bodies[index(SnapshotFormat::Binary)]));
 
-            // 初始化原子指针
-            std::atomic_store(&active_snapshot_, s1);
-            background_buffer_ = s2;
+            // gzip 版本留给读者按需压缩 (没人要的格式和代都不压缩)；
+            // 槽位此时没有读者，换入前台时的 exchange 保证读者看到这里的重置
+            for (size_t f = 0; f < kFormats; ++f)
+                slot.gzip_state[f].store(kGzipEmpty, std::memory_order_relaxed);
         }
 
-        // 前台指针 (读者看这个)
-        std::shared_ptr<SystemSnapshot> active_snapshot_;
+        // 读者线程调用，调用者持有该槽位 (写者不会同时改写它)
+        // 第一个把状态从 kGzipEmpty 换成 kGzipBusy 的读者负责压缩，其余读者等它完成，所以每代只压缩一次，
+        // 与抓取间隔无关；压缩器只有一个，用锁串行 (每代每格式最多一次，不在热路径上)
+        std::shared_ptr<const std::string> gzip_once(Slot &slot, size_t f)
+        {
+            std::atomic<uint32_t> &state = slot.gzip_state[f];
+            uint32_t s = state.load(std::memory_order_acquire);
+            if (s == kGzipEmpty && state.compare_exchange_strong(s, kGzipBusy, std::memory_order_acquire))
+            {
+                bool ok;
+                {
+                    std::lock_guard<std::mutex> lock(gzip_mutex_);
+                    ok = gzip_.compress(*slot.bodies[f], *writable(slot.gzip[f]));
+                }
+                s = ok ? kGzipReady : kGzipFailed;
+                state.store(s, std::memory_order_release);
+            }
+            while (s == kGzipBusy)
+            {
+                std::this_thread::yield();
+                s = state.load(std::memory_order_acquire);
+            }
+            return s == kGzipReady ? slot.gzip[f] : nullptr;
+        }
+
+        // 槽位进入后台时已经没有读者，只剩仍在发送中的旧响应可能还持有上一份缓冲区：
+        // 没人持有就原地复用 (保留容量)，否则换一份新的，旧的由最后一个持有者释放
+        static std::string *writable(std::shared_ptr<std::string> &buf)
+        {
+            if (buf && buf.use_count() == 1)
+                std::atomic_thread_fence(std::memory_order_acquire); // 与其它持有者释放时的递减配对
+            else
+                buf = std::make_shared<std::string>();
+            return buf.get();
+        }
+
+        // 槽位不在前台，且所有获取过它的读者都已释放
+        bool drained(uint32_t slot) const
+        {
+            return slots_[slot].released.load(std::memory_order_acquire) == slots_[slot].acquired;
+        }
+
+        Slot slots_[kSlots];
+
+        // 高 32 位：前台槽位下标；低 32 位：本次成为前台以来的获取次数
+        alignas(64) std::atomic<uint64_t> state_{0};
+
+        // 前台快照的发布序号 (初始的空快照为 0)
+        alignas(64) std::atomic<uint64_t> generation_{0};
+
+        uint64_t epoch_ = 0;
+
+        // 后台槽位下标，只有写者访问
+        uint32_t background_ = 1;
+
+        // 二进制编码器的复用状态，只有写者访问
+        SnapshotEncoder encoder_;
+
+        // gzip 压缩器的复用状态，由正在压缩的读者持锁使用
+        std::mutex gzip_mutex_;
+        GzipCompressor gzip_;
 
-        // 后台指针 (写者写这个)，这是线程私有的，不需要原子保护
-        std::shared_ptr<SystemSnapshot> background_buffer_;
+        SnapshotStream stream_;
     };
 
-} // namespace flow_scope
\ No newline at end of file
+} // namespace flow_scope
@@ -1,54 +1,414 @@
 #pragma once
+#include <cstring>
+#include <utility>
 #include <string>
 #include <vector>
-#include <nlohmann/json.hpp>
+#include "json_writer.hpp"
+#include "text_writer.hpp"
 
 namespace flow_scope
 {
 
+    // 某一种丢包原因的累计次数
+    struct DropReasonMetrics
+    {
+        const char *reason; // 指向 DropMonitor 持有的名称
+        uint64_t count;
+    };
+
     // 强制 64 字节对齐，避免多核 Cache 颠簸
     struct alignas(64) InterfaceMetrics
     {
         std::string name;
+        uint32_t ifindex = 0;
         double rtt_ms = 0.0;
-        double packet_loss_rate = 0.0;
+        double packet_loss_rate = 0.0;   // ICMP 探测在最近 packet_loss_window 个结果里的丢包比例
+        uint32_t packet_loss_window = 0;  // 丢包率的统计窗口 (探测数)
+        uint32_t packet_loss_samples = 0; // 窗口里已有结果的探测数 (刚启动时小于窗口)
         uint64_t rx_bps = 0;
         uint64_t tx_bps = 0;
         uint64_t tcp_retrans_total = 0;
+
+        // 内核 TCP 平滑 RTT 在上一个周期内的分位数 (来自 BPF 直方图)
+        double tcp_rtt_p50_ms = 0.0;
+        double tcp_rtt_p90_ms = 0.0;
+        double tcp_rtt_p99_ms = 0.0;
+        uint64_t tcp_rtt_samples = 0;
+
+        // 内核丢包 (kfree_skb) 累计次数及按原因的分解，只包含非零原因
+        uint64_t drops_total = 0;
+        std::vector<DropReasonMetrics> drops;
+
+        // 清空采集值，保留 name 和 drops 已有的容量，供下一个周期复用
+        void clear_values()
+        {
+            rtt_ms = 0.0;
+            packet_loss_rate = 0.0;
+            packet_loss_window = 0;
+            packet_loss_samples = 0;
+            rx_bps = 0;
+            tx_bps = 0;
+            tcp_retrans_total = 0;
+            tcp_rtt_p50_ms = 0.0;
+            tcp_rtt_p90_ms = 0.0;
+            tcp_rtt_p99_ms = 0.0;
+            tcp_rtt_samples = 0;
+            drops_total = 0;
+            drops.resize(0);
+        }
+    };
+
+    // 重传最严重的 TCP 流
+    struct FlowMetrics
+    {
+        std::string src;
+        std::string dst;
+        uint16_t sport = 0;
+        uint16_t dport = 0;
+        uint64_t retrans = 0;       // 上一个采集周期内的重传次数
+        uint64_t retrans_total = 0; // 累计重传次数
+    };
+
+    // 单次重传事件 (来自 BPF Ring Buffer)
+    struct RetransEventMetrics
+    {
+        uint64_t ts_ns = 0; // Unix 时间 (纳秒)
+        std::string src;
+        std::string dst;
+        uint16_t sport = 0;
+        uint16_t dport = 0;
+        uint32_t ifindex = 0;
+        const char *state = ""; // TCP 状态名，指向静态字符串
+    };
+
+    // 单个 ICMP 探测目标的统计 (由 RttMonitor 写入)
+    // rtt_* 优先用内核收发时间戳计算；rtt_user_* 是同一批回包在用户态测得的 RTT (包含 agent 的调度延迟)
+    // min / avg / max 从启动开始累计 (同 ping 的汇总行)；jitter 按 RFC 3550 对相邻 RTT 之差做平滑；
+    // loss_rate 只看最近 loss_window 个已有结果的探测 (loss_samples 是其中实际有结果的个数)
+    struct RttTargetMetrics
+    {
+        std::string target;
+        double rtt_ms = 0.0; // 最近一次回包的 RTT
+        double rtt_min_ms = 0.0;
+        double rtt_avg_ms = 0.0;
+        double rtt_max_ms = 0.0;
+        double jitter_ms = 0.0;
+        double loss_rate = 0.0;
+        uint32_t loss_window = 0;
+        uint32_t loss_samples = 0;
+        uint64_t sent = 0;     // 累计发送的探测数
+        uint64_t received = 0; // 累计收到的回包数
+        double rtt_user_ms = 0.0;     // 用户态测得的最近一次 RTT
+        double rtt_user_avg_ms = 0.0; // 用户态测得的平均 RTT
     };
 
     struct SystemSnapshot
     {
-        uint64_t timestamp;
+        uint64_t timestamp = 0;
+        uint64_t generation = 0;        // 发布序号，由 Manager::publish_snapshot 填写，单调递增
+        uint64_t tcp_retrans_total = 0; // 全局重传总数 (包含无法归属到网卡的部分)
         std::vector<InterfaceMetrics> interfaces;
+        // 由 LossMonitor::collect_all 整体覆盖 (resize 复用元素)，reset 不清空
+        std::vector<FlowMetrics> top_flows;
+        // 上一个周期内最近的重传事件 (同样由 LossMonitor::collect_all 整体覆盖)
+        std::vector<RetransEventMetrics> retrans_events;
+        uint64_t retrans_events_dropped = 0; // 内核 Ring Buffer 满导致的累计丢弃数
+        uint32_t drop_untracked_interfaces = 0; // 丢包统计槽位用完、没有被统计的网卡数 (DropMonitor 写入)
+        // 每个 ICMP 探测目标一条 (由 RttMonitor::collect_all 整体覆盖)
+        std::vector<RttTargetMetrics> rtt_targets;
 
         // 为了复用内存，我们增加一个 reset 方法，而不是销毁对象
         void reset()
         {
             // timestamp 更新由调用者负责
-            // interfaces 不 clear，而是保留 capacity，避免重新分配内存
-            // 实际逻辑中，如果网卡数量不变，甚至不需要动 vector，这里简化处理
-            interfaces.clear();
+            // interfaces 不 clear：下一个周期由 prepare_interfaces 原地覆盖，
+            // 元素里的 name / drops 的内存都能复用
+            for (auto &iface : interfaces)
+                iface.clear_values();
+        }
+
+        // 按当前网卡表调整 interfaces 的长度并写入名字和 ifindex
+        // 网卡数不变时不会分配：resize 不缩容，网卡名不超过 IFNAMSIZ，落在 std::string 的 SSO 里
+        template <typename InfoList>
+        void prepare_interfaces(const InfoList &infos)
+        {
+            interfaces.resize(infos.size());
+            size_t i = 0;
+            for (const auto &info : infos)
+            {
+                InterfaceMetrics &iface = interfaces[i++];
+                iface.name.assign(info.name);
+                iface.ifindex = info.ifindex;
+                iface.clear_values();
+            }
+        }
+
+        // 紧凑 JSON，直接写入 out (先清空，复用其容量)，不构建 DOM
+        // 与原来 nlohmann::json DOM 的 dump() 输出格式一致：对象的键按字母序写出
+        void to_json(std::string &out) const
+        {
+            JsonWriter w(out);
+            w.clear();
+
+            w.begin_object();
+            w.key("drop_untracked_interfaces").value(drop_untracked_interfaces);
+            w.key("interfaces").begin_array();
+            for (const auto &iface : interfaces)
+            {
+                w.begin_object();
+                w.key("drops");
+                write_drops(w, iface.drops);
+                w.key("drops_total").value(iface.drops_total);
+                w.key("ifindex").value(iface.ifindex);
+                w.key("loss_rate").value(iface.packet_loss_rate);
+                w.key("loss_samples").value(iface.packet_loss_samples);
+                w.key("loss_window").value(iface.packet_loss_window);
+                w.key("name").value(iface.name);
+                w.key("rtt_ms").value(iface.rtt_ms);
+                w.key("rx_bps").value(iface.rx_bps);
+                w.key("tcp_retrans").value(iface.tcp_retrans_total);
+                w.key("tcp_rtt_p50_ms").value(iface.tcp_rtt_p50_ms);
+                w.key("tcp_rtt_p90_ms").value(iface.tcp_rtt_p90_ms);
+                w.key("tcp_rtt_p99_ms").value(iface.tcp_rtt_p99_ms);
+                w.key("tcp_rtt_samples").value(iface.tcp_rtt_samples);
+                w.key("tx_bps").value(iface.tx_bps);
+                w.end_object();
+            }
+            w.end_array();
+
+            w.key("retrans_events").begin_array();
+            for (const auto &ev : retrans_events)
+            {
+                w.begin_object();
+                w.key("dport").value(ev.dport);
+                w.key("dst").value(ev.dst);
+                w.key("ifindex").value(ev.ifindex);
+                w.key("sport").value(ev.sport);
+                w.key("src").value(ev.src);
+                w.key("state").value(ev.state);
+                w.key("ts_ns").value(ev.ts_ns);
+                w.end_object();
+            }
+            w.end_array();
+
+            w.key("retrans_events_dropped").value(retrans_events_dropped);
+
+            w.key("rtt_targets").begin_array();
+            for (const auto &t : rtt_targets)
+            {
+                w.begin_object();
+                w.key("jitter_ms").value(t.jitter_ms);
+                w.key("loss_rate").value(t.loss_rate);
+                w.key("loss_samples").value(t.loss_samples);
+                w.key("loss_window").value(t.loss_window);
+                w.key("received").value(t.received);
+                w.key("rtt_avg_ms").value(t.rtt_avg_ms);
+                w.key("rtt_max_ms").value(t.rtt_max_ms);
+                w.key("rtt_min_ms").value(t.rtt_min_ms);
+                w.key("rtt_ms").value(t.rtt_ms);
+                w.key("rtt_user_avg_ms").value(t.rtt_user_avg_ms);
+                w.key("rtt_user_ms").value(t.rtt_user_ms);
+                w.key("sent").value(t.sent);
+                w.key("target").value(t.target);
+                w.end_object();
+            }
+            w.end_array();
+
+            w.key("system").value("flow_scope");
+            w.key("tcp_retrans_total").value(tcp_retrans_total);
+            w.key("timestamp").value(timestamp);
+
+            w.key("top_flows").begin_array();
+            for (const auto &flow : top_flows)
+            {
+                w.begin_object();
+                w.key("dport").value(flow.dport);
+                w.key("dst").value(flow.dst);
+                w.key("retrans").value(flow.retrans);
+                w.key("retrans_total").value(flow.retrans_total);
+                w.key("sport").value(flow.sport);
+                w.key("src").value(flow.src);
+                w.end_object();
+            }
+            w.end_array();
+            w.end_object();
         }
 
-        nlohmann::json to_json() const
+        // Prometheus 文本格式 (0.0.4)，直接写入 out (先清空，复用其容量)，不经过 JSON DOM
+        // 网卡作为 interface 标签；Top 流和重传事件是高基数的明细，不导出
+        void to_prometheus(std::string &out) const
         {
-            // ... (保持原样)
-            nlohmann::json j;
-            j["system"] = "flow_scope";
-            j["timestamp"] = timestamp;
-            j["interfaces"] = nlohmann::json::array();
+            TextWriter w(out);
+            w.clear();
+
+            family(w, "flow_scope_snapshot_timestamp_seconds", "gauge", "Unix time of the snapshot");
+            w.put("flow_scope_snapshot_timestamp_seconds ").put_u64(timestamp).put('\n');
+
+            family(w, "flow_scope_tcp_retrans_total", "counter", "TCP retransmissions on all interfaces");
+            w.put("flow_scope_tcp_retrans_total ").put_u64(tcp_retrans_total).put('\n');
+
+            family(w, "flow_scope_retrans_events_dropped_total", "counter",
+                   "Retransmit events dropped because the BPF ring buffer was full");
+            w.put("flow_scope_retrans_events_dropped_total ").put_u64(retrans_events_dropped).put('\n');
+
+            family(w, "flow_scope_drop_untracked_interfaces", "gauge",
+                   "Interfaces whose kernel drops are not counted because all drop slots are in use");
+            w.put("flow_scope_drop_untracked_interfaces ").put_u64(drop_untracked_interfaces).put('\n');
+
+            family(w, "flow_scope_interface_rx_bytes_per_second", "gauge", "Receive rate");
+            for (const auto &iface : interfaces)
+                series(w, "flow_scope_interface_rx_bytes_per_second", iface).put_u64(iface.rx_bps).put('\n');
+
+            family(w, "flow_scope_interface_tx_bytes_per_second", "gauge", "Transmit rate");
+            for (const auto &iface : interfaces)
+                series(w, "flow_scope_interface_tx_bytes_per_second", iface).put_u64(iface.tx_bps).put('\n');
+
+            family(w, "flow_scope_interface_rtt_milliseconds", "gauge", "ICMP probe round-trip time");
+            for (const auto &iface : interfaces)
+                series(w, "flow_scope_interface_rtt_milliseconds", iface).put_double(iface.rtt_ms).put('\n');
+
+            family(w, "flow_scope_interface_packet_loss_ratio", "gauge", "ICMP probe loss ratio over the recent window");
+            for (const auto &iface : interfaces)
+                series(w, "flow_scope_interface_packet_loss_ratio", iface).put_double(iface.packet_loss_rate).put('\n');
+
+            family(w, "flow_scope_interface_packet_loss_samples", "gauge", "ICMP probe outcomes in the loss window");
+            for (const auto &iface : interfaces)
+                series(w, "flow_scope_interface_packet_loss_samples", iface).put_u64(iface.packet_loss_samples).put('\n');
+
+            family(w, "flow_scope_interface_packet_loss_window", "gauge", "Size of the ICMP probe loss window");
             for (const auto &iface : interfaces)
+                series(w, "flow_scope_interface_packet_loss_window", iface).put_u64(iface.packet_loss_window).put('\n');
+
+            family(w, "flow_scope_interface_tcp_retrans_total", "counter", "TCP retransmissions per interface");
+            for (const auto &iface : interfaces)
+                series(w, "flow_scope_interface_tcp_retrans_total", iface).put_u64(iface.tcp_retrans_total).put('\n');
+
+            // quantile 是 summary 类型的保留标签，这里是普通 gauge，分位数用 percentile 标签区分
+            family(w, "flow_scope_interface_tcp_rtt_milliseconds", "gauge",
+                   "Kernel TCP smoothed RTT percentiles over the last interval");
+            for (const auto &iface : interfaces)
+            {
+                series(w, "flow_scope_interface_tcp_rtt_milliseconds", iface, "percentile", "50")
+                    .put_double(iface.tcp_rtt_p50_ms)
+                    .put('\n');
+                series(w, "flow_scope_interface_tcp_rtt_milliseconds", iface, "percentile", "90")
+                    .put_double(iface.tcp_rtt_p90_ms)
+                    .put('\n');
+                series(w, "flow_scope_interface_tcp_rtt_milliseconds", iface, "percentile", "99")
+                    .put_double(iface.tcp_rtt_p99_ms)
+                    .put('\n');
+            }
+
+            family(w, "flow_scope_interface_tcp_rtt_samples", "gauge", "TCP RTT samples in the last interval");
+            for (const auto &iface : interfaces)
+                series(w, "flow_scope_interface_tcp_rtt_samples", iface).put_u64(iface.tcp_rtt_samples).put('\n');
+
+            family(w, "flow_scope_interface_drops_total", "counter", "Kernel packet drops (kfree_skb) per interface");
+            for (const auto &iface : interfaces)
+                series(w, "flow_scope_interface_drops_total", iface).put_u64(iface.drops_total).put('\n');
+
+            family(w, "flow_scope_interface_drops_by_reason_total", "counter", "Kernel packet drops by drop reason");
+            for (const auto &iface : interfaces)
+                for (const auto &d : iface.drops)
+                    series(w, "flow_scope_interface_drops_by_reason_total", iface, "reason", d.reason)
+                        .put_u64(d.count)
+                        .put('\n');
+
+            family(w, "flow_scope_probe_rtt_milliseconds", "gauge", "Last ICMP probe round-trip time per target");
+            for (const auto &t : rtt_targets)
+                series(w, "flow_scope_probe_rtt_milliseconds", t).put_double(t.rtt_ms).put('\n');
+
+            family(w, "flow_scope_probe_rtt_min_milliseconds", "gauge", "Minimum ICMP probe RTT since start");
+            for (const auto &t : rtt_targets)
+                series(w, "flow_scope_probe_rtt_min_milliseconds", t).put_double(t.rtt_min_ms).put('\n');
+
+            family(w, "flow_scope_probe_rtt_avg_milliseconds", "gauge", "Mean ICMP probe RTT since start");
+            for (const auto &t : rtt_targets)
+                series(w, "flow_scope_probe_rtt_avg_milliseconds", t).put_double(t.rtt_avg_ms).put('\n');
+
+            family(w, "flow_scope_probe_rtt_max_milliseconds", "gauge", "Maximum ICMP probe RTT since start");
+            for (const auto &t : rtt_targets)
+                series(w, "flow_scope_probe_rtt_max_milliseconds", t).put_double(t.rtt_max_ms).put('\n');
+
+            family(w, "flow_scope_probe_rtt_user_milliseconds", "gauge",
+                   "Last ICMP probe RTT measured in userspace (includes agent scheduling delay)");
+            for (const auto &t : rtt_targets)
+                series(w, "flow_scope_probe_rtt_user_milliseconds", t).put_double(t.rtt_user_ms).put('\n');
+
+            family(w, "flow_scope_probe_rtt_user_avg_milliseconds", "gauge",
+                   "Mean ICMP probe RTT measured in userspace since start");
+            for (const auto &t : rtt_targets)
+                series(w, "flow_scope_probe_rtt_user_avg_milliseconds", t).put_double(t.rtt_user_avg_ms).put('\n');
+
+            family(w, "flow_scope_probe_jitter_milliseconds", "gauge", "ICMP probe RTT jitter (RFC 3550)");
+            for (const auto &t : rtt_targets)
+                series(w, "flow_scope_probe_jitter_milliseconds", t).put_double(t.jitter_ms).put('\n');
+
+            family(w, "flow_scope_probe_loss_ratio", "gauge", "ICMP probe loss ratio over the recent window");
+            for (const auto &t : rtt_targets)
+                series(w, "flow_scope_probe_loss_ratio", t).put_double(t.loss_rate).put('\n');
+
+            family(w, "flow_scope_probe_loss_samples", "gauge", "ICMP probe outcomes in the loss window");
+            for (const auto &t : rtt_targets)
+                series(w, "flow_scope_probe_loss_samples", t).put_u64(t.loss_samples).put('\n');
+
+            family(w, "flow_scope_probe_loss_window", "gauge", "Size of the ICMP probe loss window");
+            for (const auto &t : rtt_targets)
+                series(w, "flow_scope_probe_loss_window", t).put_u64(t.loss_window).put('\n');
+
+            family(w, "flow_scope_probe_sent_total", "counter", "ICMP probes sent");
+            for (const auto &t : rtt_targets)
+                series(w, "flow_scope_probe_sent_total", t).put_u64(t.sent).put('\n');
+
+            family(w, "flow_scope_probe_received_total", "counter", "ICMP probe replies received");
+            for (const auto &t : rtt_targets)
+                series(w, "flow_scope_probe_received_total", t).put_u64(t.received).put('\n');
+        }
+
+    private:
+        // drops 是 "原因 -> 次数" 的对象，键同样要按字母序；原因重复时保留最后一个 (同 DOM 的覆盖语义)
+        static void write_drops(JsonWriter &w, const std::vector<DropReasonMetrics> &drops)
+        {
+            thread_local std::vector<const DropReasonMetrics *> sorted;
+            sorted.clear();
+            for (const auto &d : drops)
+                sorted.push_back(&d);
+            // 插入排序：元素很少，而且稳定、不像 std::stable_sort 那样申请临时缓冲区
+            for (size_t i = 1; i < sorted.size(); ++i)
+                for (size_t j = i; j > 0 && std::strcmp(sorted[j - 1]->reason, sorted[j]->reason) > 0; --j)
+                    std::swap(sorted[j - 1], sorted[j]);
+
+            w.begin_object();
+            for (size_t i = 0; i < sorted.size(); ++i)
             {
-                j["interfaces"].push_back({{"name", iface.name},
-                                           {"rtt_ms", iface.rtt_ms},
-                                           {"loss_rate", iface.packet_loss_rate},
-                                           {"rx_bps", iface.rx_bps},
-                                           {"tx_bps", iface.tx_bps},
-                                           {"tcp_retrans", iface.tcp_retrans_total}});
+                if (i + 1 < sorted.size() && std::strcmp(sorted[i]->reason, sorted[i + 1]->reason) == 0)
+                    continue;
+                w.key(sorted[i]->reason).value(sorted[i]->count);
             }
-            return j;
+            w.end_object();
+        }
+
+        static void family(TextWriter &w, const char *name, const char *type, const char *help)
+        {
+            w.put("# HELP ").put(name).put(' ').put(help).put('\n');
+            w.put("# TYPE ").put(name).put(' ').put(type).put('\n');
+        }
+
+        // 写出 "name{interface="eth0"[,key="value"]} "，返回 w 以便接着写值
+        static TextWriter &series(TextWriter &w, const char *name, const InterfaceMetrics &iface,
+                                  const char *key = nullptr, const char *value = nullptr)
+        {
+            w.put(name).put("{interface=\"").put_label_value(iface.name).put('"');
+            if (key)
+                w.put(',').put(key).put("=\"").put_label_value(value).put('"');
+            return w.put("} ");
+        }
+
+        // 写出 "name{target="10.0.0.1"} "
+        static TextWriter &series(TextWriter &w, const char *name, const RttTargetMetrics &t)
+        {
+            return w.put(name).put("{target=\"").put_label_value(t.target).put("\"} ");
         }
     };
 
-} // namespace flow_scope
\ No newline at end of file
+} // namespace flow_scope
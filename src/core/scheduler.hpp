@@ -51,7 +51,23 @@ namespace flow_scope
             epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, tfd, &ev);
 
             // 保存 callback 和 fd 的映射，防止内存泄漏 (简单实现)
-            tasks_.push_back({tfd, callback});
+            tasks_.push_back({tfd, callback, true});
+        }
+
+        // 添加 IO 任务：fd 可读时执行回调 (水平触发)
+        // fd 由调用者拥有，回调里必须把数据读完，否则会被反复触发
+        void add_io_task(int fd, std::function<void()> callback)
+        {
+            struct epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0)
+            {
+                perror("epoll_ctl(ADD) failed");
+                return;
+            }
+
+            tasks_.push_back({fd, callback, false});
         }
 
         // 开始事件循环 (阻塞)
@@ -71,15 +87,17 @@ namespace flow_scope
                 {
                     int fd = events[i].data.fd;
 
-                    // 读取 timerfd (必须读，否则会一直触发)
-                    uint64_t exp;
-                    read(fd, &exp, sizeof(uint64_t));
-
                     // 查找并执行回调
                     for (auto &task : tasks_)
                     {
                         if (task.fd == fd)
                         {
+                            // 读取 timerfd (必须读，否则会一直触发)
+                            if (task.is_timer)
+                            {
+                                uint64_t exp;
+                                read(fd, &exp, sizeof(uint64_t));
+                            }
                             task.callback();
                             break;
                         }
@@ -98,6 +116,7 @@ namespace flow_scope
         {
             int fd;
             std::function<void()> callback;
+            bool is_timer;
         };
         std::vector<Task> tasks_;
     };
@@ -0,0 +1,131 @@
+#pragma once
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "metrics.hpp"
+#include "shm_reader.hpp"
+
+namespace flow_scope
+{
+
+    // 把最新快照的每网卡指标写进 POSIX 共享内存 (布局和读取端见 shm_reader.hpp)
+    // 段在启动时按容量一次性创建，之后每次发布只做 seqlock 保护下的 memcpy 级写入，不分配内存
+    class ShmExporter
+    {
+    public:
+        ShmExporter(const std::string &name, uint32_t capacity) : name_(name)
+        {
+            int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+            if (fd < 0)
+            {
+                perror("shm_open failed");
+                return;
+            }
+
+            size_ = shm_segment_size(capacity);
+            if (ftruncate(fd, static_cast<off_t>(size_)) != 0)
+            {
+                perror("ftruncate(shm) failed");
+                close(fd);
+                return;
+            }
+
+            void *p = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (p == MAP_FAILED)
+            {
+                perror("mmap(shm) failed");
+                return;
+            }
+            base_ = p;
+
+            // 重新初始化整个段 (可能是上次运行留下的)；magic 最后写，读者看到 magic 时其余字段已就绪
+            std::memset(base_, 0, size_);
+            ShmHeader *h = header();
+            h->version = kShmVersion;
+            h->capacity = capacity;
+            h->header_size = sizeof(ShmHeader);
+            h->seq.store(0, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            h->magic = kShmMagic;
+        }
+
+        ~ShmExporter()
+        {
+            if (base_)
+            {
+                // 先标记关闭：已经映射着这个段的读者从此读到 Unavailable，而不是一直拿到最后一代
+                header()->seq.store(kShmSeqClosed, std::memory_order_release);
+                munmap(base_, size_);
+                shm_unlink(name_.c_str());
+            }
+        }
+
+        ShmExporter(const ShmExporter &) = delete;
+        ShmExporter &operator=(const ShmExporter &) = delete;
+
+        bool ok() const { return base_ != nullptr; }
+
+        // 写入一代快照 (只有一个写者)
+        void publish(const SystemSnapshot &snap)
+        {
+            if (!base_)
+                return;
+
+            ShmHeader *h = header();
+            uint64_t seq = h->seq.load(std::memory_order_relaxed);
+
+            // 1. seq 变奇数，之后的写入不能被重排到它前面
+            h->seq.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            // 2. 写数据
+            uint32_t count = snap.interfaces.size() < h->capacity ? static_cast<uint32_t>(snap.interfaces.size())
+                                                                    : h->capacity;
+            ShmInterface *out = interfaces();
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                const InterfaceMetrics &m = snap.interfaces[i];
+                ShmInterface &e = out[i];
+                size_t len = m.name.size() < sizeof(e.name) - 1 ? m.name.size() : sizeof(e.name) - 1;
+                std::memcpy(e.name, m.name.data(), len);
+                std::memset(e.name + len, 0, sizeof(e.name) - len);
+                e.ifindex = m.ifindex;
+                e.reserved = 0;
+                e.rtt_ms = m.rtt_ms;
+                e.loss_rate = m.packet_loss_rate;
+                e.rx_bps = m.rx_bps;
+                e.tx_bps = m.tx_bps;
+                e.tcp_retrans = m.tcp_retrans_total;
+                e.tcp_rtt_p50_ms = m.tcp_rtt_p50_ms;
+                e.tcp_rtt_p90_ms = m.tcp_rtt_p90_ms;
+                e.tcp_rtt_p99_ms = m.tcp_rtt_p99_ms;
+                e.tcp_rtt_samples = m.tcp_rtt_samples;
+                e.drops_total = m.drops_total;
+                e.loss_window = m.packet_loss_window;
+                e.loss_samples = m.packet_loss_samples;
+            }
+            h->generation = snap.generation;
+            h->timestamp = snap.timestamp;
+            h->tcp_retrans_total = snap.tcp_retrans_total;
+            h->count = count;
+            h->total = static_cast<uint32_t>(snap.interfaces.size());
+
+            // 3. seq 变回偶数，发布以上写入
+            h->seq.store(seq + 2, std::memory_order_release);
+        }
+
+    private:
+        std::string name_;
+        void *base_ = nullptr;
+        size_t size_ = 0;
+
+        ShmHeader *header() { return static_cast<ShmHeader *>(base_); }
+        ShmInterface *interfaces() { return reinterpret_cast<ShmInterface *>(static_cast<char *>(base_) + sizeof(ShmHeader)); }
+    };
+
+} // namespace flow_scope
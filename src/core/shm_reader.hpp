@@ -0,0 +1,244 @@
+#pragma once
+// flow_scope 共享内存快照 (--shm=NAME) 的布局和读取端
+// 只依赖标准库和 POSIX，可以直接拷贝到同机的消费端工程里使用
+//
+// 段内容 = ShmHeader + capacity 个 ShmInterface，由 seqlock 保护：
+// 写者改写前把 seq 加一 (变成奇数)，写完再加一 (变回偶数)；
+// 读者读前读后各看一次 seq，两次相同且为偶数才说明读到的是完整的一代，否则重试。
+// 读者只 mmap 只读映射，整个读取过程没有系统调用，也不会阻塞写者。
+// 重试次数有上限：写者在发布中途退出时 seq 会一直停在奇数，读者返回 Busy 而不是永远自旋。
+// 写者正常退出时先把 seq 置为 kShmSeqClosed 再 unlink：已经映射着旧段的读者之后都读到 Unavailable，
+// 应当关闭 reader 重新打开 (重启后的写者会在同名下创建新的段)，而不是一直读到最后一代的旧数据
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace flow_scope
+{
+
+    constexpr uint32_t kShmMagic = 0x50534C46; // "FLSP"
+    constexpr uint32_t kShmVersion = 1;
+
+    // 每个网卡一条，定长 (64 字节对齐)
+    struct alignas(64) ShmInterface
+    {
+        char name[16]; // '\0' 结尾
+        uint32_t ifindex;
+        uint32_t reserved;
+        double rtt_ms;
+        double loss_rate;
+        uint64_t rx_bps;
+        uint64_t tx_bps;
+        uint64_t tcp_retrans;
+        double tcp_rtt_p50_ms;
+        double tcp_rtt_p90_ms;
+        double tcp_rtt_p99_ms;
+        uint64_t tcp_rtt_samples;
+        uint64_t drops_total;
+        // 以下字段占用原来的尾部填充，整体大小不变；较早的写者留下的是 0
+        uint32_t loss_window;  // loss_rate 的统计窗口 (探测数)
+        uint32_t loss_samples; // 窗口里已有结果的探测数
+    };
+    static_assert(sizeof(ShmInterface) == 128, "ShmInterface layout changed");
+
+    struct alignas(64) ShmHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t capacity;       // interfaces[] 的容量 (创建时确定)
+        uint32_t header_size;    // sizeof(ShmHeader)，数据区从这里开始
+        std::atomic<uint64_t> seq; // seqlock 序号，奇数表示正在写
+        // 以下字段受 seq 保护
+        uint64_t generation;     // 快照发布序号
+        uint64_t timestamp;      // Unix 时间 (秒)
+        uint64_t tcp_retrans_total;
+        uint32_t count;          // 有效网卡数 (<= capacity)
+        uint32_t total;          // 快照里的网卡总数，大于 count 说明容量不够被截断了
+    };
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "seqlock needs a lock-free 64-bit atomic");
+
+    // 读取结果
+    enum class ShmReadStatus
+    {
+        Ok,
+        NotFound,    // read_interface: 这一代里没有该网卡
+        Busy,        // 重试次数用完仍没读到完整的一代 (写者太频繁，或写者在发布中途退出，段已陈旧)
+        Unavailable, // 段没有映射成功，或写者已经退出 (段已关闭)：需要重新打开
+    };
+
+    // 段已关闭的 seq 值 (奇数，旧的读者实现会把它当作正在写而重试)
+    constexpr uint64_t kShmSeqClosed = ~0ULL;
+
+    // 默认重试上限：前 kShmSpinRetries 次空转，之后每次重试前让出 CPU
+    // 正常发布一代只需要微秒级，这个上限 (约数毫秒) 只会在写者异常时触发
+    constexpr int kShmSpinRetries = 128;
+    constexpr int kShmMaxRetries = 4096;
+
+    inline size_t shm_segment_size(uint32_t capacity)
+    {
+        return sizeof(ShmHeader) + static_cast<size_t>(capacity) * sizeof(ShmInterface);
+    }
+
+    // 读取端：一次完整读取得到的快照
+    struct ShmSnapshot
+    {
+        uint64_t generation = 0;
+        uint64_t timestamp = 0;
+        uint64_t tcp_retrans_total = 0;
+        uint32_t total = 0;
+        std::vector<ShmInterface> interfaces;
+    };
+
+    class ShmSnapshotReader
+    {
+    public:
+        // name 同 shm_open 的名字 (如 "/flow_scope")
+        explicit ShmSnapshotReader(const std::string &name)
+        {
+            int fd = shm_open(name.c_str(), O_RDONLY, 0);
+            if (fd < 0)
+                return;
+
+            struct stat st;
+            if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(ShmHeader))
+            {
+                void *p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+                if (p != MAP_FAILED)
+                {
+                    base_ = p;
+                    size_ = static_cast<size_t>(st.st_size);
+                }
+            }
+            close(fd);
+
+            // interfaces() 按 header_size 定位数据区，必须和本端的布局一致
+            if (base_ && (header()->magic != kShmMagic || header()->version != kShmVersion ||
+                          header()->header_size != sizeof(ShmHeader) ||
+                          shm_segment_size(header()->capacity) > size_ ||
+                          header()->seq.load(std::memory_order_acquire) == kShmSeqClosed))
+            {
+                munmap(base_, size_);
+                base_ = nullptr;
+            }
+        }
+
+        ~ShmSnapshotReader()
+        {
+            if (base_)
+                munmap(base_, size_);
+        }
+
+        ShmSnapshotReader(const ShmSnapshotReader &) = delete;
+        ShmSnapshotReader &operator=(const ShmSnapshotReader &) = delete;
+
+        bool ok() const { return base_ != nullptr; }
+
+        // 当前发布序号 (一次原子读取，可用于判断是否有新数据)
+        uint64_t generation() const
+        {
+            const ShmHeader *h = header();
+            uint64_t s = h->seq.load(std::memory_order_acquire);
+            uint64_t g = h->generation;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return h->seq.load(std::memory_order_relaxed) == s && !(s & 1) ? g : 0;
+        }
+
+        // 读取整份快照 (out.interfaces 的容量会复用)
+        // 返回 Ok / Busy / Unavailable；不是 Ok 时 out 的内容无意义，Unavailable 时应重新打开
+        ShmReadStatus read(ShmSnapshot &out, int max_retries = kShmMaxRetries) const
+        {
+            if (!base_)
+                return ShmReadStatus::Unavailable;
+            const ShmHeader *h = header();
+            for (int attempt = 0; attempt < max_retries; backoff(++attempt))
+            {
+                uint64_t s1 = h->seq.load(std::memory_order_acquire);
+                if (s1 == kShmSeqClosed)
+                    return ShmReadStatus::Unavailable;
+                if (s1 & 1)
+                    continue; // 写者正在写
+
+                out.generation = h->generation;
+                out.timestamp = h->timestamp;
+                out.tcp_retrans_total = h->tcp_retrans_total;
+                out.total = h->total;
+                uint32_t count = h->count;
+                if (count > h->capacity)
+                    continue; // 读到了写了一半的值
+                out.interfaces.resize(count);
+                std::memcpy(static_cast<void *>(out.interfaces.data()), interfaces(), count * sizeof(ShmInterface));
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (h->seq.load(std::memory_order_relaxed) == s1)
+                    return ShmReadStatus::Ok;
+            }
+            return ShmReadStatus::Busy;
+        }
+
+        // 只读一个网卡 (按名字)，找不到返回 NotFound，Unavailable 时应重新打开；适合高频读取少量指标
+        ShmReadStatus read_interface(const char *name, ShmInterface &out, uint64_t *generation = nullptr,
+                                     int max_retries = kShmMaxRetries) const
+        {
+            if (!base_)
+                return ShmReadStatus::Unavailable;
+            const ShmHeader *h = header();
+            for (int attempt = 0; attempt < max_retries; backoff(++attempt))
+            {
+                uint64_t s1 = h->seq.load(std::memory_order_acquire);
+                if (s1 == kShmSeqClosed)
+                    return ShmReadStatus::Unavailable;
+                if (s1 & 1)
+                    continue;
+
+                bool found = false;
+                uint32_t count = h->count;
+                if (count > h->capacity)
+                    continue;
+                const ShmInterface *ifaces = interfaces();
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    if (std::strncmp(ifaces[i].name, name, sizeof(ifaces[i].name)) == 0)
+                    {
+                        std::memcpy(static_cast<void *>(&out), &ifaces[i], sizeof(out));
+                        found = true;
+                        break;
+                    }
+                }
+                uint64_t g = h->generation;
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (h->seq.load(std::memory_order_relaxed) == s1)
+                {
+                    if (generation)
+                        *generation = g;
+                    return found ? ShmReadStatus::Ok : ShmReadStatus::NotFound;
+                }
+            }
+            return ShmReadStatus::Busy;
+        }
+
+    private:
+        void *base_ = nullptr;
+        size_t size_ = 0;
+
+        const ShmHeader *header() const { return static_cast<const ShmHeader *>(base_); }
+
+        static void backoff(int attempt)
+        {
+            if (attempt > kShmSpinRetries)
+                std::this_thread::yield();
+        }
+        const ShmInterface *interfaces() const
+        {
+            return reinterpret_cast<const ShmInterface *>(static_cast<const char *>(base_) + header()->header_size);
+        }
+    };
+
+} // namespace flow_scope
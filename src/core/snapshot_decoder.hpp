@@ -0,0 +1,412 @@
+#pragma once
+// flow_scope 二进制快照 (GET /metrics/binary) 的解码器
+// 只依赖标准库，可以直接拷贝到消费端的工程里使用
+//
+// 格式 (版本 1，所有定长整数和 double 都是小端)：
+//
+//   header   : magic "FSNP" | u16 version | u16 header_len (当前为 8)
+//   schema   : varint section_count，之后每个 section: varint field_count + field_count 个类型字节
+//   names    : varint count，之后每个字符串: varint len + bytes (快照里所有字符串都只出现一次)
+//   system   : 按 schema[SECTION_SYSTEM] 的字段
+//   interface: varint count，每个网卡按 schema[SECTION_INTERFACE] 的字段
+//   flow     : varint count，每条流按 schema[SECTION_FLOW] 的字段
+//   event    : varint count，每个事件按 schema[SECTION_EVENT] 的字段
+//   rtt      : varint count，每个探测目标按 schema[SECTION_RTT_TARGET] 的字段
+//
+// 字段类型：FIELD_VARINT (LEB128 无符号)、FIELD_F64 (8 字节)、FIELD_STR (名字表下标，varint)、
+// FIELD_STR_VARINT_LIST (varint n，之后 n 个 "名字表下标 + varint" 对)
+//
+// 兼容规则：同一个版本内只会在各 section 末尾追加字段，或在末尾追加新的 section。解码器按 schema 读取自己认识的前几个字段，
+// 认识范围之外的字段按类型跳过，认识范围之外的 section 不读；编码端没有的字段和 section 保持默认值。
+// 自己认识的字段在 schema 里的类型必须与下面的字段表一致，否则说明布局不兼容，解码失败。
+// 版本号只在做不到上述兼容时 (删除或改变已有字段) 才增加，解码器拒绝比自己新的版本
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace flow_scope
+{
+    namespace snapshot_format
+    {
+        constexpr char kMagic[4] = {'F', 'S', 'N', 'P'};
+        constexpr uint16_t kVersion = 1;
+        constexpr uint16_t kHeaderLen = 8;
+
+        enum FieldType : uint8_t
+        {
+            FIELD_VARINT = 0,
+            FIELD_F64 = 1,
+            FIELD_STR = 2,
+            FIELD_STR_VARINT_LIST = 3,
+        };
+
+        enum Section : uint8_t
+        {
+            SECTION_SYSTEM = 0,
+            SECTION_INTERFACE = 1,
+            SECTION_FLOW = 2,
+            SECTION_EVENT = 3,
+            SECTION_RTT_TARGET = 4,
+            SECTION_COUNT = 5,
+        };
+
+        // 版本 1 的字段布局，顺序即编码顺序
+        // system   : timestamp, tcp_retrans_total, retrans_events_dropped, drop_untracked_interfaces
+        // interface: name, ifindex, rtt_ms, loss_rate, rx_bps, tx_bps, tcp_retrans,
+        //            tcp_rtt_p50_ms, tcp_rtt_p90_ms, tcp_rtt_p99_ms, tcp_rtt_samples, drops_total, drops,
+        //            loss_window, loss_samples
+        // flow     : src, dst, sport, dport, retrans, retrans_total
+        // event    : ts_ns, src, dst, sport, dport, ifindex, state
+        // rtt      : target, rtt_ms, rtt_min_ms, rtt_avg_ms, rtt_max_ms, jitter_ms, loss_rate, sent, received,
+        //            rtt_user_ms, rtt_user_avg_ms, loss_window, loss_samples
+        constexpr uint8_t kSystemFields[] = {FIELD_VARINT, FIELD_VARINT, FIELD_VARINT, FIELD_VARINT};
+        constexpr uint8_t kInterfaceFields[] = {FIELD_STR, FIELD_VARINT, FIELD_F64, FIELD_F64, FIELD_VARINT,
+                                                FIELD_VARINT, FIELD_VARINT, FIELD_F64, FIELD_F64, FIELD_F64,
+                                                FIELD_VARINT, FIELD_VARINT, FIELD_STR_VARINT_LIST, FIELD_VARINT,
+                                                FIELD_VARINT};
+        constexpr uint8_t kFlowFields[] = {FIELD_STR, FIELD_STR, FIELD_VARINT, FIELD_VARINT, FIELD_VARINT, FIELD_VARINT};
+        constexpr uint8_t kEventFields[] = {FIELD_VARINT, FIELD_STR, FIELD_STR, FIELD_VARINT,
+                                            FIELD_VARINT, FIELD_VARINT, FIELD_STR};
+        constexpr uint8_t kRttTargetFields[] = {FIELD_STR, FIELD_F64, FIELD_F64, FIELD_F64, FIELD_F64,
+                                                FIELD_F64, FIELD_F64, FIELD_VARINT, FIELD_VARINT, FIELD_F64, FIELD_F64,
+                                                FIELD_VARINT, FIELD_VARINT};
+    } // namespace snapshot_format
+
+    // 解码结果 (字段含义与 JSON 输出一致)
+    struct DecodedSnapshot
+    {
+        struct Drop
+        {
+            std::string reason;
+            uint64_t count = 0;
+        };
+
+        struct Interface
+        {
+            std::string name;
+            uint32_t ifindex = 0;
+            double rtt_ms = 0.0;
+            double loss_rate = 0.0;
+            uint32_t loss_window = 0;
+            uint32_t loss_samples = 0;
+            uint64_t rx_bps = 0;
+            uint64_t tx_bps = 0;
+            uint64_t tcp_retrans = 0;
+            double tcp_rtt_p50_ms = 0.0;
+            double tcp_rtt_p90_ms = 0.0;
+            double tcp_rtt_p99_ms = 0.0;
+            uint64_t tcp_rtt_samples = 0;
+            uint64_t drops_total = 0;
+            std::vector<Drop> drops;
+        };
+
+        struct Flow
+        {
+            std::string src;
+            std::string dst;
+            uint16_t sport = 0;
+            uint16_t dport = 0;
+            uint64_t retrans = 0;
+            uint64_t retrans_total = 0;
+        };
+
+        struct Event
+        {
+            uint64_t ts_ns = 0;
+            std::string src;
+            std::string dst;
+            uint16_t sport = 0;
+            uint16_t dport = 0;
+            uint32_t ifindex = 0;
+            std::string state;
+        };
+
+        struct RttTarget
+        {
+            std::string target;
+            double rtt_ms = 0.0;
+            double rtt_min_ms = 0.0;
+            double rtt_avg_ms = 0.0;
+            double rtt_max_ms = 0.0;
+            double jitter_ms = 0.0;
+            double loss_rate = 0.0;
+            uint64_t sent = 0;
+            uint64_t received = 0;
+            double rtt_user_ms = 0.0;
+            double rtt_user_avg_ms = 0.0;
+            uint32_t loss_window = 0;
+            uint32_t loss_samples = 0;
+        };
+
+        uint16_t version = 0;
+        uint64_t timestamp = 0;
+        uint64_t tcp_retrans_total = 0;
+        uint64_t retrans_events_dropped = 0;
+        uint32_t drop_untracked_interfaces = 0;
+        std::vector<Interface> interfaces;
+        std::vector<Flow> top_flows;
+        std::vector<Event> retrans_events;
+        std::vector<RttTarget> rtt_targets;
+    };
+
+    // 解码一份二进制快照，格式错误或数据截断时返回 false
+    class SnapshotDecoder
+    {
+    public:
+        bool decode(const char *data, size_t len, DecodedSnapshot &out)
+        {
+            using namespace snapshot_format;
+
+            p_ = reinterpret_cast<const uint8_t *>(data);
+            end_ = p_ + len;
+            ok_ = true;
+            out = DecodedSnapshot();
+
+            // 1. 头部
+            if (len < kHeaderLen || std::memcmp(data, kMagic, sizeof(kMagic)) != 0)
+                return false;
+            out.version = static_cast<uint16_t>(p_[4] | (p_[5] << 8));
+            uint16_t header_len = static_cast<uint16_t>(p_[6] | (p_[7] << 8));
+            if (out.version == 0 || out.version > kVersion || header_len < kHeaderLen || header_len > len)
+                return false;
+            p_ += header_len;
+
+            // 2. schema
+            uint64_t sections = varint();
+            if (!ok_ || sections > 64)
+                return false;
+            schema_.assign(sections, {});
+            for (auto &fields : schema_)
+            {
+                uint64_t n = varint();
+                if (!ok_ || n > static_cast<uint64_t>(end_ - p_))
+                    return false;
+                fields.assign(p_, p_ + n);
+                p_ += n;
+            }
+            if (!schema_compatible())
+                return false;
+
+            // 3. 名字表
+            uint64_t n_names = varint();
+            if (!ok_ || n_names > static_cast<uint64_t>(end_ - p_))
+                return false;
+            names_.resize(n_names);
+            for (auto &name : names_)
+            {
+                uint64_t n = varint();
+                if (!ok_ || n > static_cast<uint64_t>(end_ - p_))
+                    return false;
+                name.assign(reinterpret_cast<const char *>(p_), n);
+                p_ += n;
+            }
+
+            // 4. 各 section
+            Record sys = record(SECTION_SYSTEM);
+            out.timestamp = sys.u64(0);
+            out.tcp_retrans_total = sys.u64(1);
+            out.retrans_events_dropped = sys.u64(2);
+            out.drop_untracked_interfaces = static_cast<uint32_t>(sys.u64(3));
+
+            out.interfaces.resize(count());
+            for (auto &iface : out.interfaces)
+            {
+                Record r = record(SECTION_INTERFACE);
+                iface.name = r.str(0);
+                iface.ifindex = static_cast<uint32_t>(r.u64(1));
+                iface.rtt_ms = r.f64(2);
+                iface.loss_rate = r.f64(3);
+                iface.rx_bps = r.u64(4);
+                iface.tx_bps = r.u64(5);
+                iface.tcp_retrans = r.u64(6);
+                iface.tcp_rtt_p50_ms = r.f64(7);
+                iface.tcp_rtt_p90_ms = r.f64(8);
+                iface.tcp_rtt_p99_ms = r.f64(9);
+                iface.tcp_rtt_samples = r.u64(10);
+                iface.drops_total = r.u64(11);
+                iface.drops = std::move(r.drops);
+                iface.loss_window = static_cast<uint32_t>(r.u64(13));
+                iface.loss_samples = static_cast<uint32_t>(r.u64(14));
+            }
+
+            out.top_flows.resize(count());
+            for (auto &flow : out.top_flows)
+            {
+                Record r = record(SECTION_FLOW);
+                flow.src = r.str(0);
+                flow.dst = r.str(1);
+                flow.sport = static_cast<uint16_t>(r.u64(2));
+                flow.dport = static_cast<uint16_t>(r.u64(3));
+                flow.retrans = r.u64(4);
+                flow.retrans_total = r.u64(5);
+            }
+
+            out.retrans_events.resize(count());
+            for (auto &ev : out.retrans_events)
+            {
+                Record r = record(SECTION_EVENT);
+                ev.ts_ns = r.u64(0);
+                ev.src = r.str(1);
+                ev.dst = r.str(2);
+                ev.sport = static_cast<uint16_t>(r.u64(3));
+                ev.dport = static_cast<uint16_t>(r.u64(4));
+                ev.ifindex = static_cast<uint32_t>(r.u64(5));
+                ev.state = r.str(6);
+            }
+
+            // 较早的编码端没有这个 section，也就没有它的元素个数
+            if (schema_.size() > SECTION_RTT_TARGET)
+            {
+                out.rtt_targets.resize(count());
+                for (auto &t : out.rtt_targets)
+                {
+                    Record r = record(SECTION_RTT_TARGET);
+                    t.target = r.str(0);
+                    t.rtt_ms = r.f64(1);
+                    t.rtt_min_ms = r.f64(2);
+                    t.rtt_avg_ms = r.f64(3);
+                    t.rtt_max_ms = r.f64(4);
+                    t.jitter_ms = r.f64(5);
+                    t.loss_rate = r.f64(6);
+                    t.sent = r.u64(7);
+                    t.received = r.u64(8);
+                    t.rtt_user_ms = r.f64(9);
+                    t.rtt_user_avg_ms = r.f64(10);
+                    t.loss_window = static_cast<uint32_t>(r.u64(11));
+                    t.loss_samples = static_cast<uint32_t>(r.u64(12));
+                }
+            }
+
+            return ok_;
+        }
+
+    private:
+        // 一条记录里已读出的前 kMaxFields 个字段 (整数、double 和字符串下标共用 raw)
+        static constexpr size_t kMaxFields = 16;
+        struct Record
+        {
+            uint64_t raw[kMaxFields] = {};
+            double f[kMaxFields] = {};
+            std::vector<DecodedSnapshot::Drop> drops;
+            const std::vector<std::string> *names = nullptr;
+
+            uint64_t u64(size_t i) const { return raw[i]; }
+            double f64(size_t i) const { return f[i]; }
+            std::string str(size_t i) const { return raw[i] < names->size() ? (*names)[raw[i]] : std::string(); }
+        };
+
+        const uint8_t *p_ = nullptr;
+        const uint8_t *end_ = nullptr;
+        bool ok_ = true;
+        std::vector<std::vector<uint8_t>> schema_;
+        std::vector<std::string> names_;
+
+        uint64_t varint()
+        {
+            uint64_t v = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                if (p_ >= end_)
+                    break;
+                uint8_t b = *p_++;
+                v |= static_cast<uint64_t>(b & 0x7F) << shift;
+                if (!(b & 0x80))
+                    return v;
+            }
+            ok_ = false;
+            return 0;
+        }
+
+        // 元素个数 (防止损坏的数据导致超大的 resize：每个元素至少占 1 字节)
+        size_t count()
+        {
+            uint64_t n = varint();
+            if (n > static_cast<uint64_t>(end_ - p_))
+            {
+                ok_ = false;
+                return 0;
+            }
+            return static_cast<size_t>(n);
+        }
+
+        // 已知 section 里已知下标的字段类型必须和字段表一致 (编码端字段更少或更多都可以)
+        bool schema_compatible() const
+        {
+            using namespace snapshot_format;
+            struct Known
+            {
+                const uint8_t *types;
+                size_t n;
+            };
+            static const Known known[SECTION_COUNT] = {
+                {kSystemFields, sizeof(kSystemFields)},
+                {kInterfaceFields, sizeof(kInterfaceFields)},
+                {kFlowFields, sizeof(kFlowFields)},
+                {kEventFields, sizeof(kEventFields)},
+                {kRttTargetFields, sizeof(kRttTargetFields)},
+            };
+            for (size_t s = 0; s < schema_.size() && s < SECTION_COUNT; ++s)
+            {
+                const auto &fields = schema_[s];
+                for (size_t i = 0; i < fields.size() && i < known[s].n; ++i)
+                    if (fields[i] != known[s].types[i])
+                        return false;
+            }
+            return true;
+        }
+
+        Record record(size_t section)
+        {
+            Record r;
+            r.names = &names_;
+            if (section >= schema_.size())
+                return r; // 编码端没有这个 section，全部取默认值
+
+            const auto &fields = schema_[section];
+            for (size_t i = 0; i < fields.size() && ok_; ++i)
+            {
+                switch (fields[i])
+                {
+                case snapshot_format::FIELD_VARINT:
+                case snapshot_format::FIELD_STR:
+                {
+                    uint64_t v = varint();
+                    if (i < kMaxFields)
+                        r.raw[i] = v;
+                    break;
+                }
+                case snapshot_format::FIELD_F64:
+                {
+                    if (end_ - p_ < 8)
+                    {
+                        ok_ = false;
+                        break;
+                    }
+                    if (i < kMaxFields)
+                        std::memcpy(&r.f[i], p_, 8);
+                    p_ += 8;
+                    break;
+                }
+                case snapshot_format::FIELD_STR_VARINT_LIST:
+                {
+                    size_t n = count();
+                    for (size_t k = 0; k < n && ok_; ++k)
+                    {
+                        uint64_t name = varint();
+                        uint64_t value = varint();
+                        if (i < kMaxFields)
+                            r.drops.push_back({name < names_.size() ? names_[name] : std::string(), value});
+                    }
+                    break;
+                }
+                default:
+                    ok_ = false; // 不认识的类型无法跳过
+                    break;
+                }
+            }
+            return r;
+        }
+    };
+
+} // namespace flow_scope
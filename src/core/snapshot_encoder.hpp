@@ -0,0 +1,214 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "metrics.hpp"
+#include "snapshot_decoder.hpp"
+
+namespace flow_scope
+{
+
+    // SystemSnapshot 的二进制编码器，格式说明见 snapshot_decoder.hpp
+    // 快照里的字符串 (网卡名、丢包原因、地址、TCP 状态、探测目标) 都放进名字表，正文只写下标；计数器用 varint。
+    // 编码器自身的缓冲区和去重表都复用，只由写者线程使用，稳态下零内存分配
+    class SnapshotEncoder
+    {
+    public:
+        void encode(const SystemSnapshot &snap, std::string &out)
+        {
+            using namespace snapshot_format;
+
+            // 1. 先编码正文，同时收集名字表 (名字表要写在正文前面)
+            body_.clear();
+            names_.clear();
+            std::fill(slots_.begin(), slots_.end(), kEmpty);
+
+            put_varint(body_, snap.timestamp);
+            put_varint(body_, snap.tcp_retrans_total);
+            put_varint(body_, snap.retrans_events_dropped);
+            put_varint(body_, snap.drop_untracked_interfaces);
+
+            put_varint(body_, snap.interfaces.size());
+            for (const auto &iface : snap.interfaces)
+            {
+                put_str(iface.name);
+                put_varint(body_, iface.ifindex);
+                put_f64(body_, iface.rtt_ms);
+                put_f64(body_, iface.packet_loss_rate);
+                put_varint(body_, iface.rx_bps);
+                put_varint(body_, iface.tx_bps);
+                put_varint(body_, iface.tcp_retrans_total);
+                put_f64(body_, iface.tcp_rtt_p50_ms);
+                put_f64(body_, iface.tcp_rtt_p90_ms);
+                put_f64(body_, iface.tcp_rtt_p99_ms);
+                put_varint(body_, iface.tcp_rtt_samples);
+                put_varint(body_, iface.drops_total);
+                put_varint(body_, iface.drops.size());
+                for (const auto &d : iface.drops)
+                {
+                    put_str(d.reason);
+                    put_varint(body_, d.count);
+                }
+                put_varint(body_, iface.packet_loss_window);
+                put_varint(body_, iface.packet_loss_samples);
+            }
+
+            put_varint(body_, snap.top_flows.size());
+            for (const auto &flow : snap.top_flows)
+            {
+                put_str(flow.src);
+                put_str(flow.dst);
+                put_varint(body_, flow.sport);
+                put_varint(body_, flow.dport);
+                put_varint(body_, flow.retrans);
+                put_varint(body_, flow.retrans_total);
+            }
+
+            put_varint(body_, snap.retrans_events.size());
+            for (const auto &ev : snap.retrans_events)
+            {
+                put_varint(body_, ev.ts_ns);
+                put_str(ev.src);
+                put_str(ev.dst);
+                put_varint(body_, ev.sport);
+                put_varint(body_, ev.dport);
+                put_varint(body_, ev.ifindex);
+                put_str(ev.state);
+            }
+
+            put_varint(body_, snap.rtt_targets.size());
+            for (const auto &t : snap.rtt_targets)
+            {
+                put_str(t.target);
+                put_f64(body_, t.rtt_ms);
+                put_f64(body_, t.rtt_min_ms);
+                put_f64(body_, t.rtt_avg_ms);
+                put_f64(body_, t.rtt_max_ms);
+                put_f64(body_, t.jitter_ms);
+                put_f64(body_, t.loss_rate);
+                put_varint(body_, t.sent);
+                put_varint(body_, t.received);
+                put_f64(body_, t.rtt_user_ms);
+                put_f64(body_, t.rtt_user_avg_ms);
+                put_varint(body_, t.loss_window);
+                put_varint(body_, t.loss_samples);
+            }
+
+            // 2. 头部 + schema + 名字表 + 正文
+            out.clear();
+            out.append(kMagic, sizeof(kMagic));
+            put_u16(out, kVersion);
+            put_u16(out, kHeaderLen);
+
+            put_varint(out, SECTION_COUNT);
+            put_fields(out, kSystemFields, sizeof(kSystemFields));
+            put_fields(out, kInterfaceFields, sizeof(kInterfaceFields));
+            put_fields(out, kFlowFields, sizeof(kFlowFields));
+            put_fields(out, kEventFields, sizeof(kEventFields));
+            put_fields(out, kRttTargetFields, sizeof(kRttTargetFields));
+
+            put_varint(out, names_.size());
+            for (auto name : names_)
+            {
+                put_varint(out, name.size());
+                out.append(name.data(), name.size());
+            }
+
+            out.append(body_);
+        }
+
+    private:
+        static constexpr uint32_t kEmpty = UINT32_MAX;
+
+        std::string body_;
+        std::vector<std::string_view> names_; // 指向快照里的字符串，只在 encode 期间有效
+        std::vector<uint32_t> slots_;          // 开放寻址去重表：names_ 下标
+
+        static void put_varint(std::string &out, uint64_t v)
+        {
+            char buf[10];
+            size_t n = 0;
+            while (v >= 0x80)
+            {
+                buf[n++] = static_cast<char>((v & 0x7F) | 0x80);
+                v >>= 7;
+            }
+            buf[n++] = static_cast<char>(v);
+            out.append(buf, n);
+        }
+
+        static void put_u16(std::string &out, uint16_t v)
+        {
+            out.push_back(static_cast<char>(v & 0xFF));
+            out.push_back(static_cast<char>(v >> 8));
+        }
+
+        // 按主机字节序写入 (x86 / ARM 都是小端)
+        static void put_f64(std::string &out, double v)
+        {
+            char buf[8];
+            std::memcpy(buf, &v, 8);
+            out.append(buf, 8);
+        }
+
+        static void put_fields(std::string &out, const uint8_t *fields, size_t n)
+        {
+            put_varint(out, n);
+            out.append(reinterpret_cast<const char *>(fields), n);
+        }
+
+        // 字符串写成名字表下标，相同内容只入表一次
+        void put_str(std::string_view s)
+        {
+            // 装载因子不超过 1/2，容量只增不减
+            if (slots_.size() < (names_.size() + 1) * 2)
+                grow();
+
+            size_t mask = slots_.size() - 1;
+            size_t i = hash(s) & mask;
+            while (slots_[i] != kEmpty)
+            {
+                if (names_[slots_[i]] == s)
+                {
+                    put_varint(body_, slots_[i]);
+                    return;
+                }
+                i = (i + 1) & mask;
+            }
+
+            slots_[i] = static_cast<uint32_t>(names_.size());
+            names_.push_back(s);
+            put_varint(body_, slots_[i]);
+        }
+
+        void grow()
+        {
+            size_t cap = slots_.empty() ? 256 : slots_.size() * 2;
+            slots_.assign(cap, kEmpty);
+            size_t mask = cap - 1;
+            for (uint32_t idx = 0; idx < names_.size(); ++idx)
+            {
+                size_t i = hash(names_[idx]) & mask;
+                while (slots_[i] != kEmpty)
+                    i = (i + 1) & mask;
+                slots_[i] = idx;
+            }
+        }
+
+        // FNV-1a
+        static size_t hash(std::string_view s)
+        {
+            uint64_t h = 1469598103934665603ULL;
+            for (unsigned char c : s)
+            {
+                h ^= c;
+                h *= 1099511628211ULL;
+            }
+            return static_cast<size_t>(h);
+        }
+    };
+
+} // namespace flow_scope
@@ -0,0 +1,157 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace flow_scope
+{
+
+    // 快照推送：每次发布后把这一代的 JSON 响应体推给所有订阅者 (SSE 连接)
+    //
+    // - 每个订阅者一个定长环形队列，满了丢最旧的一代并计数，队列只存共享指针，不拷贝响应体
+    // - 写者 (采集线程) 只在入队时持有订阅者的锁，时间是 O(1)；发送由各连接自己的线程完成，
+    //   慢订阅者只会丢数据，不会拖住写者
+    class SnapshotStream
+    {
+    public:
+        static constexpr size_t kQueueDepth = 8;
+
+        struct Item
+        {
+            uint64_t generation = 0;
+            std::shared_ptr<const std::string> body;
+        };
+
+        class Subscriber
+        {
+        public:
+            // 取出下一代，最多等待 timeout；超时或已关闭返回 false
+            bool pop(Item &out, std::chrono::milliseconds timeout)
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (!cv_.wait_for(lock, timeout, [this]()
+                                  { return count_ > 0 || closed_; }) ||
+                    count_ == 0)
+                    return false;
+
+                out = std::move(queue_[head_]);
+                head_ = (head_ + 1) % kQueueDepth;
+                --count_;
+                return true;
+            }
+
+            // 因队列满而丢弃的代数 (累计)
+            uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+        private:
+            friend class SnapshotStream;
+
+            void push(const Item &item)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (count_ == kQueueDepth)
+                    {
+                        // 丢最旧的
+                        head_ = (head_ + 1) % kQueueDepth;
+                        --count_;
+                        dropped_.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    queue_[(head_ + count_) % kQueueDepth] = item;
+                    ++count_;
+                }
+                cv_.notify_one();
+            }
+
+            void close()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    closed_ = true;
+                }
+                cv_.notify_one();
+            }
+
+            std::mutex mutex_;
+            std::condition_variable cv_;
+            Item queue_[kQueueDepth];
+            size_t head_ = 0;
+            size_t count_ = 0;
+            bool closed_ = false;
+            std::atomic<uint64_t> dropped_{0};
+        };
+
+        // 新订阅者；达到 max_subscribers 时返回空指针
+        std::shared_ptr<Subscriber> subscribe(size_t max_subscribers)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (subscribers_.size() >= max_subscribers)
+                return nullptr;
+            auto sub = std::make_shared<Subscriber>();
+            subscribers_.push_back(sub);
+            active_.store(subscribers_.size(), std::memory_order_relaxed);
+            return sub;
+        }
+
+        void unsubscribe(const std::shared_ptr<Subscriber> &sub)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t i = 0; i < subscribers_.size(); ++i)
+            {
+                if (subscribers_[i] == sub)
+                {
+                    dropped_total_ += sub->dropped();
+                    subscribers_[i] = std::move(subscribers_.back());
+                    subscribers_.pop_back();
+                    break;
+                }
+            }
+            active_.store(subscribers_.size(), std::memory_order_relaxed);
+            sub->close();
+        }
+
+        // 写者调用：推送新的一代；没有订阅者时只有一次原子读取
+        void publish(uint64_t generation, const std::shared_ptr<const std::string> &body)
+        {
+            if (active_.load(std::memory_order_relaxed) == 0)
+                return;
+
+            Item item{generation, body};
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto &sub : subscribers_)
+                sub->push(item);
+        }
+
+        size_t subscribers() const { return active_.load(std::memory_order_relaxed); }
+
+        // 关闭所有订阅者：正在等待的 pop 立即返回 false (用于退出时结束 SSE 连接)
+        void close_all()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto &sub : subscribers_)
+                sub->close();
+        }
+
+        // 所有订阅者 (包括已断开的) 累计丢弃的代数
+        uint64_t dropped_total()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            uint64_t total = dropped_total_;
+            for (const auto &sub : subscribers_)
+                total += sub->dropped();
+            return total;
+        }
+
+    private:
+        std::mutex mutex_; // 保护订阅者列表 (增删很少，发布时只遍历)
+        std::vector<std::shared_ptr<Subscriber>> subscribers_;
+        std::atomic<size_t> active_{0};
+        uint64_t dropped_total_ = 0;
+    };
+
+} // namespace flow_scope
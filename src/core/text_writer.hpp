@@ -0,0 +1,77 @@
+#pragma once
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace flow_scope
+{
+
+    // 直接往 std::string 末尾追加文本的小工具
+    // 数字用 std::to_chars 格式化 (不经过 locale、不经过 stream)，缓冲区由调用者持有并复用，
+    // clear() 保留容量，输出长度稳定后不再分配内存
+    class TextWriter
+    {
+    public:
+        explicit TextWriter(std::string &out) : out_(out) {}
+
+        void clear() { out_.clear(); }
+
+        TextWriter &put(char c)
+        {
+            out_.push_back(c);
+            return *this;
+        }
+
+        TextWriter &put(std::string_view s)
+        {
+            out_.append(s.data(), s.size());
+            return *this;
+        }
+
+        TextWriter &put_u64(uint64_t v)
+        {
+            char buf[24];
+            auto r = std::to_chars(buf, buf + sizeof(buf), v);
+            out_.append(buf, static_cast<size_t>(r.ptr - buf));
+            return *this;
+        }
+
+        // 最短往返表示 (%g 风格)；NaN / Inf 写成 Prometheus 认识的 NaN / +Inf / -Inf
+        TextWriter &put_double(double v)
+        {
+            if (std::isnan(v))
+                return put("NaN");
+            if (std::isinf(v))
+                return put(v > 0 ? "+Inf" : "-Inf");
+
+            char buf[32];
+            auto r = std::to_chars(buf, buf + sizeof(buf), v);
+            out_.append(buf, static_cast<size_t>(r.ptr - buf));
+            return *this;
+        }
+
+        // 写入标签值，按 Prometheus 文本格式转义反斜杠、双引号和换行
+        TextWriter &put_label_value(std::string_view s)
+        {
+            for (char c : s)
+            {
+                if (c == '\\')
+                    out_.append("\\\\", 2);
+                else if (c == '"')
+                    out_.append("\\\"", 2);
+                else if (c == '\n')
+                    out_.append("\\n", 2);
+                else
+                    out_.push_back(c);
+            }
+            return *this;
+        }
+
+    private:
+        std::string &out_;
+    };
+
+} // namespace flow_scope
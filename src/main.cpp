@@ -1,18 +1,128 @@
 #include <iostream>
+#include <memory>
 #include <thread>
 #include <vector>
-#include <fstream>
+#include <cstring>
+#include <getopt.h>
+#include <signal.h>
+#include <sys/signalfd.h>
 #include "core/manager.hpp"
 #include "core/scheduler.hpp" // 新增
+#include "core/interface_registry.hpp"
+#include "core/shm_exporter.hpp"
 #include "server/http_server.hpp"
 #include "collectors/rtt_monitor.hpp"
 #include "collectors/traffic_monitor.hpp"
 #include "collectors/loss_monitor.hpp"
+#include "collectors/tcp_rtt_monitor.hpp"
+#include "collectors/drop_monitor.hpp"
 
 using namespace flow_scope;
 
-int main()
+static void print_usage(const char *prog)
 {
+    std::cout << "Usage: " << prog << " [options]\n"
+              << "  --traffic-backend=procfs|netlink  网卡计数器数据源 (默认 procfs)\n"
+              << "  --include=PATTERN                 只监控匹配的网卡，可重复 (通配符，默认全部)\n"
+              << "  --exclude=PATTERN                 排除匹配的网卡，可重复 (优先于 --include)\n"
+              << "  --rtt-target=IP                   ICMP 探测目标，可重复 (默认 8.8.8.8)\n"
+              << "  --loss-window=N                   丢包率统计最近多少个探测 (默认 100，最大 65536)\n"
+              << "  --drop-slots=N                    丢包统计最多跟踪的网卡数 (默认 256，最大 65536，每个网卡每 CPU 占 1KB 内核内存)\n"
+              << "  --shm=NAME                        同时把快照导出到 POSIX 共享内存 (如 /flow_scope)\n"
+              << "  --shm-capacity=N                  共享内存里最多容纳的网卡数 (默认 1024)\n"
+              << "  -h, --help                        显示帮助\n";
+}
+
+int main(int argc, char **argv)
+{
+    // 0. 解析命令行参数
+    TrafficBackend traffic_backend = TrafficBackend::Procfs;
+    std::vector<std::string> include_patterns;
+    std::vector<std::string> exclude_patterns;
+    std::vector<std::string> rtt_targets;
+    uint32_t loss_window = RttMonitor::kDefaultLossWindow;
+    uint32_t drop_slots = DROP_IF_SLOTS;
+    std::string shm_name;
+    uint32_t shm_capacity = 1024;
+
+    static const struct option long_opts[] = {
+        {"traffic-backend", required_argument, nullptr, 'b'},
+        {"include", required_argument, nullptr, 'i'},
+        {"exclude", required_argument, nullptr, 'x'},
+        {"rtt-target", required_argument, nullptr, 't'},
+        {"loss-window", required_argument, nullptr, 'w'},
+        {"drop-slots", required_argument, nullptr, 'd'},
+        {"shm", required_argument, nullptr, 's'},
+        {"shm-capacity", required_argument, nullptr, 'c'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}};
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_opts, nullptr)) != -1)
+    {
+        switch (opt)
+        {
+        case 'b':
+            if (strcmp(optarg, "netlink") == 0)
+                traffic_backend = TrafficBackend::Netlink;
+            else if (strcmp(optarg, "procfs") == 0)
+                traffic_backend = TrafficBackend::Procfs;
+            else
+            {
+                std::cerr << "ERROR: unknown traffic backend: " << optarg << std::endl;
+                return 1;
+            }
+            break;
+        case 'i':
+            include_patterns.push_back(optarg);
+            break;
+        case 'x':
+            exclude_patterns.push_back(optarg);
+            break;
+        case 't':
+            rtt_targets.push_back(optarg);
+            break;
+        case 'w':
+            loss_window = static_cast<uint32_t>(strtoul(optarg, nullptr, 10));
+            if (loss_window == 0 || loss_window > RttMonitor::kMaxLossWindow)
+            {
+                std::cerr << "ERROR: invalid --loss-window: " << optarg << std::endl;
+                return 1;
+            }
+            break;
+        case 'd':
+        {
+            char *end = nullptr;
+            unsigned long v = optarg[0] >= '0' && optarg[0] <= '9' ? strtoul(optarg, &end, 10) : 0;
+            if (!end || *end != '\0' || v == 0 || v > BpfObject::kMaxDropIfSlots)
+            {
+                std::cerr << "ERROR: invalid --drop-slots: " << optarg << " (1 ~ " << BpfObject::kMaxDropIfSlots << ")"
+                          << std::endl;
+                return 1;
+            }
+            drop_slots = static_cast<uint32_t>(v);
+            break;
+        }
+        case 's':
+            shm_name = optarg;
+            break;
+        case 'c':
+            shm_capacity = static_cast<uint32_t>(strtoul(optarg, nullptr, 10));
+            if (shm_capacity == 0)
+            {
+                std::cerr << "ERROR: invalid --shm-capacity: " << optarg << std::endl;
+                return 1;
+            }
+            break;
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
     if (geteuid() != 0)
     {
         std::cerr << "ERROR: Root privileges required." << std::endl;
@@ -24,37 +134,74 @@ int main()
     // 1. 初始化采集模块
     // 注意：我们将它们声明为 static 或者放在堆上，确保在 lambda 中有效
     // 为了简单，这里直接实例化在 main 栈上，引用捕获即可
-    RttMonitor rtt_mon("8.8.8.8");
-    TrafficMonitor traffic_mon;
-    LossMonitor loss_mon;
-
-    // 自动寻找网卡
-    std::string target_iface = "lo";
-    std::ifstream file("/proc/net/dev");
-    std::string line;
-    while (std::getline(file, line))
+    if (rtt_targets.empty())
+        rtt_targets.push_back("8.8.8.8");
+    RttMonitor rtt_mon(rtt_targets, true, RttMonitor::kMaxBatch, loss_window);
+    TrafficMonitor traffic_mon(traffic_backend);
+
+    // eBPF 采集器共享同一个 BPF 对象
+    BpfObject bpf(drop_slots);
+    LossMonitor loss_mon(bpf);
+    TcpRttMonitor tcp_rtt_mon(bpf);
+    DropMonitor drop_mon(bpf);
+
+    // 可选：共享内存导出，供同机进程免系统调用读取
+    std::unique_ptr<ShmExporter> shm_exporter;
+    if (!shm_name.empty())
     {
-        if (line.find("ens33") != std::string::npos)
+        shm_exporter = std::make_unique<ShmExporter>(shm_name, shm_capacity);
+        if (!shm_exporter->ok())
         {
-            target_iface = "ens33";
-            break;
-        }
-        if (line.find("eth0") != std::string::npos)
-        {
-            target_iface = "eth0";
-            break;
-        }
-        if (line.find("wlan0") != std::string::npos)
-        {
-            target_iface = "wlan0";
-            break;
+            std::cerr << "ERROR: Failed to create shared memory segment " << shm_name << std::endl;
+            return 1;
         }
+        std::cout << "Exporting snapshots to shared memory " << shm_name << std::endl;
     }
-    std::cout << "Target Interface: " << target_iface << std::endl;
 
     // 2. 初始化调度器
     Scheduler scheduler;
 
+    // 退出信号：SIGINT / SIGTERM 经 signalfd 进入事件循环，停止调度器后 main 正常返回，
+    // 各对象的析构 (共享内存段 unlink、BPF 程序卸载等) 得以执行
+    // 必须在创建任何线程之前屏蔽，新线程继承信号掩码，信号只会经 signalfd 交付
+    sigset_t exit_signals;
+    sigemptyset(&exit_signals);
+    sigaddset(&exit_signals, SIGINT);
+    sigaddset(&exit_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &exit_signals, nullptr);
+    int signal_fd = signalfd(-1, &exit_signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd < 0)
+    {
+        perror("signalfd failed");
+        return 1;
+    }
+    scheduler.add_io_task(signal_fd, [&]()
+                          {
+        struct signalfd_siginfo si;
+        while (read(signal_fd, &si, sizeof(si)) == static_cast<ssize_t>(sizeof(si)))
+        {
+            std::cout << "Received " << strsignal(static_cast<int>(si.ssi_signo)) << ", shutting down" << std::endl;
+            scheduler.stop();
+        } });
+
+    // ICMP 回包和重传事件流都挂到 epoll 上，到达即处理
+    rtt_mon.attach(scheduler);
+    loss_mon.attach_events(scheduler);
+
+    // 实时网卡表：订阅内核链路事件，网卡增删时增量更新
+    InterfaceRegistry registry(include_patterns, exclude_patterns);
+    std::vector<MonitorBase *> monitors = {&rtt_mon, &traffic_mon, &loss_mon, &tcp_rtt_mon, &drop_mon};
+    registry.on_removed([&](const InterfaceInfo &info)
+                        {
+        for (auto *mon : monitors)
+            mon->on_interface_removed(info.ifindex, info.name); });
+    if (!registry.start(scheduler))
+    {
+        std::cerr << "ERROR: Failed to start interface discovery." << std::endl;
+        return 1;
+    }
+    std::cout << "Monitoring " << registry.interfaces().size() << " interfaces" << std::endl;
+
     // 3. 注册 1Hz (1000ms) 的采集任务
     scheduler.add_timer_task(1000, [&]()
                              {
@@ -67,30 +214,32 @@ int main()
         // 更新时间戳
         snapshot->timestamp = std::time(nullptr);
         
-        // 准备指标对象 (复用 vector 里的空间)
-        InterfaceMetrics iface_data;
-        iface_data.name = target_iface;
-
-        // 采集
-        rtt_mon.collect(iface_data);
-        traffic_mon.collect(iface_data);
-        loss_mon.collect(iface_data);
-        
-        // 放入快照
-        snapshot->interfaces.push_back(iface_data);
+        // 按实时网卡表准备快照 (复用上一轮的元素，稳态下零分配)
+        snapshot->prepare_interfaces(registry.interfaces());
+
+        // 每个采集器一次填充所有网卡 (流量计数每周期只读取一次数据源)
+        for (auto *mon : monitors)
+            mon->collect_all(*snapshot);
 
         // 发布 (交换指针)
-        mgr.publish_snapshot(); });
+        mgr.publish_snapshot();
+
+        // 共享内存里写入刚发布的这一代 (带上发布序号)
+        if (shm_exporter)
+            shm_exporter->publish(*mgr.get_snapshot()); });
 
     // 4. 启动 HTTP 服务 (在单独线程)
-    std::thread http_thread([]()
-                            {
-        HttpServer server(8080);
-        server.start(); });
-    http_thread.detach();
+    HttpServer http_server(8080);
+    std::thread http_thread([&http_server]()
+                            { http_server.start(); });
 
-    // 5. 启动调度器 (主线程阻塞在此，处理 epoll 事件)
+    // 5. 启动调度器 (主线程阻塞在此，处理 epoll 事件，直到收到退出信号)
     scheduler.run();
 
+    // 6. 先停掉 HTTP 线程再返回，之后的析构不会和它并发
+    http_server.stop();
+    http_thread.join();
+    close(signal_fd);
+
     return 0;
 }
\ No newline at end of file
@@ -1,5 +1,9 @@
 #pragma once
 #include <httplib.h>
+#include <atomic>
+#include <chrono>
+#include <string_view>
+#include <thread>
 #include "../core/manager.hpp"
 
 namespace flow_scope {
@@ -7,21 +11,217 @@ namespace flow_scope {
 class HttpServer {
 public:
     HttpServer(int port = 8080) : port_(port) {
-        svr_.Get("/metrics", [](const httplib::Request&, httplib::Response& res) {
-            auto& mgr = Manager::get_instance();
-            auto data = mgr.get_snapshot();
-            
-            res.set_content(data->to_json().dump(), "application/json");
+        // 每一代快照只在发布时序列化一次，这里只取出共享的缓冲区，不拷贝
+        svr_.Get("/metrics", [](const httplib::Request& req, httplib::Response& res) {
+            serve(req, res, SnapshotFormat::Json, "application/json");
         });
+
+        // Prometheus 文本格式，同样按代缓存
+        svr_.Get("/metrics/prometheus", [](const httplib::Request& req, httplib::Response& res) {
+            serve(req, res, SnapshotFormat::Prometheus, "text/plain; version=0.0.4; charset=utf-8");
+        });
+
+        // 紧凑二进制格式，供高频拉取的聚合端使用 (解码见 core/snapshot_decoder.hpp)
+        svr_.Get("/metrics/binary", [](const httplib::Request& req, httplib::Response& res) {
+            serve(req, res, SnapshotFormat::Binary, "application/vnd.flow-scope.snapshot");
+        });
+
+        // Server-Sent Events：每次发布立即推送整份 JSON 快照，id 为发布序号
+        // 慢客户端在自己的队列里丢最旧的代，并收到一条 dropped 事件告知累计丢弃数
+        svr_.Get("/metrics/stream", [](const httplib::Request&, httplib::Response& res) {
+            stream(res);
+        });
+
+        // 每个 SSE 连接长期占用一个工作线程，线程池按订阅上限加大，保证普通请求仍有线程可用
+        svr_.new_task_queue = [] { return new httplib::ThreadPool(CPPHTTPLIB_THREAD_POOL_COUNT + kMaxStreamSubscribers); };
     }
 
+    // 阻塞直到 stop() (或监听失败)
     void start() {
         printf("Starting flow_scope HTTP Server on port %d...\n", port_);
-        svr_.listen("0.0.0.0", port_);
+        if (!svr_.listen("0.0.0.0", port_))
+            fprintf(stderr, "HTTP server failed to listen on port %d\n", port_);
+        finished_ = true;
+    }
+
+    // 可以从其它线程调用：关闭监听，并唤醒所有 SSE 连接让它们结束，start() 随后返回
+    // start() 可能还没进入监听，先等它开始运行或已经返回，否则 stop 会落空
+    void stop() {
+        while (!svr_.is_running() && !finished_)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        svr_.stop();
+        Manager::get_instance().stream().close_all();
     }
 
 private:
     httplib::Server svr_;
+    std::atomic<bool> finished_{false};
+
+    // 响应体直接引用共享的缓冲区，发送完成前由 lambda 持有
+    // 客户端接受 gzip 时发送这一代的 gzip 版本：每代每格式只在第一个要 gzip 的请求里压缩一次，从不按请求压缩
+    static void serve(const httplib::Request& req, httplib::Response& res, SnapshotFormat format,
+                      const char* content_type) {
+        auto& mgr = Manager::get_instance();
+
+        // 条件请求：客户端已经有当前这一代，只读一次原子变量就返回 304，不碰快照
+        // ETag 用弱校验器 W/"<epoch>-<generation>"：同一代的 gzip 和未压缩版本语义相同，共用一个；
+        // 发布序号每个进程都从 0 开始，epoch (进程启动时随机生成，不变) 保证重启后旧的标签不会匹配新进程的同号代
+        const std::string& if_none_match = req.get_header_value("If-None-Match");
+        if (!if_none_match.empty()) {
+            uint64_t current = mgr.generation();
+            if (etag_matches(if_none_match, mgr.epoch(), current)) {
+                res.status = 304;
+                res.set_header("ETag", etag(mgr.epoch(), current));
+                res.set_header("Vary", "Accept-Encoding");
+                return;
+            }
+        }
+
+        std::shared_ptr<const std::string> body;
+        {
+            auto snap = mgr.get_snapshot();
+            res.set_header("ETag", etag(mgr.epoch(), snap->generation));
+            if (accepts_gzip(req.get_header_value("Accept-Encoding"))) {
+                body = snap.gzip(format);
+                if (body)
+                    res.set_header("Content-Encoding", "gzip");
+            }
+            if (!body)
+                body = snap.body(format);
+        }
+        res.set_header("Vary", "Accept-Encoding");
+
+        size_t size = body->size();
+        res.set_content_provider(
+            size, content_type,
+            [body = std::move(body)](size_t offset, size_t length, httplib::DataSink& sink) {
+                return sink.write(body->data() + offset, length);
+            });
+    }
+
+    // 标签内容 "<epoch 16 位十六进制>-<generation>"，写入 buf 并返回长度
+    static int format_tag(char* buf, size_t size, uint64_t epoch, uint64_t generation) {
+        return snprintf(buf, size, "%016llx-%llu", static_cast<unsigned long long>(epoch),
+                        static_cast<unsigned long long>(generation));
+    }
+
+    static std::string etag(uint64_t epoch, uint64_t generation) {
+        char buf[48];
+        int n = format_tag(buf, sizeof(buf), epoch, generation);
+        return "W/\"" + std::string(buf, static_cast<size_t>(n)) + "\"";
+    }
+
+    // If-None-Match 的弱比较：列表里任意一个实体标签 (忽略 W/ 前缀) 等于本进程的当前这一代，或者是 "*"
+    static bool etag_matches(const std::string& header, uint64_t epoch, uint64_t generation) {
+        char current[48];
+        int n = format_tag(current, sizeof(current), epoch, generation);
+        std::string_view want(current, static_cast<size_t>(n));
+
+        size_t pos = 0;
+        while (pos < header.size()) {
+            size_t end = header.find(',', pos);
+            if (end == std::string::npos)
+                end = header.size();
+
+            std::string_view tag = trim(std::string_view(header.data() + pos, end - pos));
+            if (tag == "*")
+                return true;
+            if (tag.substr(0, 2) == "W/")
+                tag.remove_prefix(2);
+            if (tag.size() >= 2 && tag.front() == '"' && tag.back() == '"' && tag.substr(1, tag.size() - 2) == want)
+                return true;
+            pos = end + 1;
+        }
+        return false;
+    }
+
+    static constexpr size_t kMaxStreamSubscribers = 16;
+
+    static void stream(httplib::Response& res) {
+        auto& mgr = Manager::get_instance();
+        auto sub = mgr.stream().subscribe(kMaxStreamSubscribers);
+        if (!sub) {
+            res.status = 503;
+            res.set_content("too many stream subscribers\n", "text/plain");
+            return;
+        }
+
+        // 先发当前这一代，客户端不必等到下一次发布
+        // subscribe 和取快照之间可能正好有一次发布：那一代既进了队列又成了 first，
+        // 所以队列里不比 first 新的代都跳过，同一个 id 不会发两次
+        SnapshotStream::Item first;
+        {
+            auto snap = mgr.get_snapshot();
+            first = {snap->generation, snap.body(SnapshotFormat::Json)};
+        }
+        uint64_t first_generation = first.generation;
+
+        res.set_header("Cache-Control", "no-cache");
+        res.set_chunked_content_provider(
+            "text/event-stream",
+            [sub, pending = std::move(first), first_generation, reported = uint64_t(0)](size_t, httplib::DataSink& sink) mutable {
+                SnapshotStream::Item item;
+                if (pending.body) {
+                    item = std::move(pending);
+                    pending.body.reset();
+                } else if (!sub->pop(item, std::chrono::seconds(15))) {
+                    // 长时间没有新数据 (采集停滞)，发注释行保活，顺便探测连接是否已断开
+                    return sink.write(":\n\n", 3);
+                } else if (item.generation <= first_generation) {
+                    return true; // 已经作为第一条发过了
+                }
+
+                char head[96];
+                uint64_t dropped = sub->dropped();
+                if (dropped != reported) {
+                    int n = snprintf(head, sizeof(head), "event: dropped\ndata: %llu\n\n",
+                                     static_cast<unsigned long long>(dropped));
+                    if (!sink.write(head, static_cast<size_t>(n)))
+                        return false;
+                    reported = dropped;
+                }
+
+                int n = snprintf(head, sizeof(head), "id: %llu\nevent: snapshot\ndata: ",
+                                 static_cast<unsigned long long>(item.generation));
+                return sink.write(head, static_cast<size_t>(n)) &&
+                       sink.write(item.body->data(), item.body->size()) &&
+                       sink.write("\n\n", 2);
+            },
+            [sub](bool) { Manager::get_instance().stream().unsubscribe(sub); });
+    }
+
+    // Accept-Encoding 里是否有 gzip (或 *) 且 q 不为 0
+    static bool accepts_gzip(const std::string& header) {
+        size_t pos = 0;
+        while (pos < header.size()) {
+            size_t end = header.find(',', pos);
+            if (end == std::string::npos)
+                end = header.size();
+
+            std::string_view item(header.data() + pos, end - pos);
+            size_t semi = item.find(';');
+            std::string_view coding = trim(item.substr(0, semi));
+            if (coding == "gzip" || coding == "*") {
+                if (semi == std::string_view::npos)
+                    return true;
+                std::string_view params = trim(item.substr(semi + 1));
+                // 只关心 q=0 / q=0.0 / q=0.000 这种显式拒绝
+                if (params.substr(0, 2) != "q=" || params.find_first_not_of("0.", 2) != std::string_view::npos)
+                    return true;
+            }
+            pos = end + 1;
+        }
+        return false;
+    }
+
+    static std::string_view trim(std::string_view s) {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+            s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+            s.remove_suffix(1);
+        return s;
+    }
+
     int port_;
 };
 
@@ -0,0 +1,68 @@
+#!/usr/bin/env bash
+# 在 ICMP 洪泛下对比 RttMonitor 挂 / 不挂内核 BPF 过滤器时的唤醒次数和 CPU
+# 创建一个网络命名空间和 veth 对 (主机 10.201.0.1 <-> 命名空间 10.201.0.2)，
+# 在命名空间里用 Raw Socket 持续向主机发送无关的 ICMP 包 (Echo Request + 别的 id 的 Echo Reply)，
+# 同时在主机侧运行 bench_icmp_filter 探测 10.201.0.2
+# 用法 (需 root)：
+#   cmake -S . -B build -DFLOW_SCOPE_BUILD_BENCH=ON && cmake --build build --target bench_icmp_filter
+#   sudo ./test_scripts/bench_icmp_filter.sh build/bench_icmp_filter [每种模式的秒数]
+set -euo pipefail
+
+BENCH_BIN=${1:-build/bench_icmp_filter}
+SECONDS_PER_MODE=${2:-10}
+NETNS=flow_scope_flood
+HOST_IF=fsflood0
+NS_IF=fsflood1
+
+if [[ $EUID -ne 0 ]]; then
+    echo "Error: Please run as root (for ip netns)"
+    exit 1
+fi
+
+FLOOD_PID=
+cleanup() {
+    [[ -n "$FLOOD_PID" ]] && kill "$FLOOD_PID" 2>/dev/null || true
+    ip link del "$HOST_IF" 2>/dev/null || true
+    ip netns del "$NETNS" 2>/dev/null || true
+}
+trap cleanup EXIT
+cleanup
+
+ip netns add "$NETNS"
+ip link add "$HOST_IF" type veth peer name "$NS_IF"
+ip link set "$NS_IF" netns "$NETNS"
+ip addr add 10.201.0.1/24 dev "$HOST_IF"
+ip link set "$HOST_IF" up
+ip -n "$NETNS" addr add 10.201.0.2/24 dev "$NS_IF"
+ip -n "$NETNS" link set "$NS_IF" up
+ip -n "$NETNS" link set lo up
+
+# 洪泛发送端：交替发送 Echo Request 和 id 不同的 Echo Reply，尽可能快
+ip netns exec "$NETNS" python3 - <<'EOF' &
+import socket, struct
+
+def checksum(data):
+    s = sum(struct.unpack("!%dH" % (len(data) // 2), data))
+    s = (s >> 16) + (s & 0xFFFF)
+    s += s >> 16
+    return ~s & 0xFFFF
+
+def packet(icmp_type, ident, seq):
+    hdr = struct.pack("!BBHHH", icmp_type, 0, 0, ident, seq) + b"x" * 32
+    return struct.pack("!BBHHH", icmp_type, 0, checksum(hdr), ident, seq) + b"x" * 32
+
+sock = socket.socket(socket.AF_INET, socket.SOCK_RAW, socket.IPPROTO_ICMP)
+seq = 0
+while True:
+    seq = (seq + 1) & 0xFFFF
+    try:
+        sock.sendto(packet(8, 0x4242, seq), ("10.201.0.1", 0))
+        sock.sendto(packet(0, 0x4343, seq), ("10.201.0.1", 0))
+    except OSError:
+        pass
+EOF
+FLOOD_PID=$!
+
+sleep 1
+echo "[*] background ICMP flood from $NETNS (pid $FLOOD_PID)"
+"$BENCH_BIN" 10.201.0.2 "$SECONDS_PER_MODE"
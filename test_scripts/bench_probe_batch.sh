@@ -0,0 +1,42 @@
+#!/usr/bin/env bash
+# 对 veth 对端网络命名空间里的应答方测批量探测吞吐
+# 命名空间里把 10.202.0.0/16 整段配成本地地址 (AnyIP)，由内核直接应答 Echo Request，
+# 主机侧经 veth 路由过去，运行 bench_probe_batch 比较不同 batch_size 的 probes/s 和 probes/cpu-s
+# 用法 (需 root)：
+#   cmake -S . -B build -DFLOW_SCOPE_BUILD_BENCH=ON && cmake --build build --target bench_probe_batch
+#   sudo ./test_scripts/bench_probe_batch.sh build/bench_probe_batch [目标数] [每种 batch 的探测总数]
+set -euo pipefail
+
+BENCH_BIN=${1:-build/bench_probe_batch}
+TARGETS=${2:-1000}
+PROBES=${3:-200000}
+NETNS=flow_scope_responder
+HOST_IF=fsresp0
+NS_IF=fsresp1
+
+if [[ $EUID -ne 0 ]]; then
+    echo "Error: Please run as root (for ip netns)"
+    exit 1
+fi
+
+cleanup() {
+    ip route del 10.202.0.0/16 2>/dev/null || true
+    ip link del "$HOST_IF" 2>/dev/null || true
+    ip netns del "$NETNS" 2>/dev/null || true
+}
+trap cleanup EXIT
+cleanup
+
+ip netns add "$NETNS"
+ip link add "$HOST_IF" type veth peer name "$NS_IF"
+ip link set "$NS_IF" netns "$NETNS"
+ip addr add 10.203.0.1/30 dev "$HOST_IF"
+ip link set "$HOST_IF" up
+ip -n "$NETNS" addr add 10.203.0.2/30 dev "$NS_IF"
+ip -n "$NETNS" link set "$NS_IF" up
+ip -n "$NETNS" link set lo up
+ip -n "$NETNS" route add local 10.202.0.0/16 dev lo
+ip -n "$NETNS" route add default via 10.203.0.1
+ip route add 10.202.0.0/16 via 10.203.0.2
+
+"$BENCH_BIN" "$TARGETS" "$PROBES" 10.202
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""
+测量 handle_tcp_retransmit 探针在多核重传风暴下的开销。
+
+原理：
+  1. 打开 kernel.bpf_stats_enabled，内核会为每个 BPF 程序累计 run_cnt / run_time_ns
+  2. 在 lo 上用 iptables 随机丢包，每个 CPU 上各跑一个 TCP 发送进程，制造多核并发重传
+  3. 统计窗口前后各读一次 bpftool prog show，得到平均每次触发的纳秒数
+
+用法 (需 root，且 flow_scope 已经在运行)：
+  sudo ./test_scripts/bench_retrans_probe.py [秒数]
+
+对比优化前后：分别在两个版本的 flow_scope 下运行本脚本，比较 ns/event。
+"""
+import json
+import multiprocessing
+import os
+import socket
+import subprocess
+import sys
+import time
+
+PROG_PREFIX = "handle_tcp_retr"  # 内核会把程序名截断到 15 个字符
+PORT = 47123
+DROP_PROBABILITY = 0.2
+DROP_RULE = (f"OUTPUT -o lo -p tcp --dport {PORT} -m statistic "
+             f"--mode random --probability {DROP_PROBABILITY} -j DROP")
+
+
+def read_prog_stats():
+    out = subprocess.run(["bpftool", "prog", "show", "-j"],
+                         capture_output=True, check=True, text=True).stdout
+    for prog in json.loads(out):
+        if prog.get("name", "").startswith(PROG_PREFIX):
+            return prog.get("run_cnt", 0), prog.get("run_time_ns", 0)
+    return None
+
+
+def sink_server(ready):
+    # 只负责把数据读走，保证发送端一直有数据在飞
+    srv = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    srv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    srv.bind(("127.0.0.1", PORT))
+    srv.listen(128)
+    ready.set()
+
+    def drain(conn):
+        try:
+            while conn.recv(1 << 16):
+                pass
+        except OSError:
+            pass
+
+    while True:
+        conn, _ = srv.accept()
+        multiprocessing.Process(target=drain, args=(conn,), daemon=True).start()
+
+
+def flood_worker(cpu, deadline):
+    # 绑定到指定 CPU，保证重传真正分散在多个核上
+    os.sched_setaffinity(0, {cpu})
+    payload = b"x" * (1 << 16)
+    while time.time() < deadline:
+        try:
+            sock = socket.create_connection(("127.0.0.1", PORT), timeout=2)
+            while time.time() < deadline:
+                sock.sendall(payload)
+            sock.close()
+        except OSError:
+            pass
+
+
+if __name__ == "__main__":
+    if os.geteuid() != 0:
+        print("Error: Please run as root (for iptables / bpftool)")
+        sys.exit(1)
+
+    duration = int(sys.argv[1]) if len(sys.argv) > 1 else 10
+    ncpus = os.cpu_count() or 1
+
+    if read_prog_stats() is None:
+        print(f"[!] BPF program {PROG_PREFIX}* not found, is flow_scope running?")
+        sys.exit(1)
+
+    subprocess.run("sysctl -q -w kernel.bpf_stats_enabled=1", shell=True, check=True)
+    subprocess.run(f"iptables -A {DROP_RULE}", shell=True, check=True)
+
+    ready = multiprocessing.Event()
+    server = multiprocessing.Process(target=sink_server, args=(ready,), daemon=True)
+    server.start()
+    ready.wait()
+
+    try:
+        print(f"[*] Flooding retransmits on {ncpus} CPUs for {duration}s...")
+        cnt0, ns0 = read_prog_stats()
+        deadline = time.time() + duration
+        workers = [multiprocessing.Process(target=flood_worker, args=(cpu, deadline))
+                   for cpu in range(ncpus)]
+        for w in workers:
+            w.start()
+        for w in workers:
+            w.join()
+        cnt1, ns1 = read_prog_stats()
+
+        events = cnt1 - cnt0
+        if events == 0:
+            print("[!] No retransmits observed")
+        else:
+            print(f"[*] events={events} rate={events / duration:.0f}/s "
+                  f"avg={(ns1 - ns0) / events:.1f} ns/event")
+    finally:
+        server.terminate()
+        subprocess.run(f"iptables -D {DROP_RULE}", shell=True, check=False)
+        subprocess.run("sysctl -q -w kernel.bpf_stats_enabled=0", shell=True, check=False)
@@ -0,0 +1,36 @@
+#!/usr/bin/env bash
+# 在独立的网络命名空间中创建 N 个 veth 网卡 (N/2 对)，对比 procfs 与 netlink 两种流量数据源
+# 用法 (需 root)：
+#   cmake -S . -B build -DFLOW_SCOPE_BUILD_BENCH=ON && cmake --build build --target bench_traffic_backends
+#   sudo ./test_scripts/bench_traffic_backends.sh build/bench_traffic_backends
+set -euo pipefail
+
+BENCH_BIN=${1:-build/bench_traffic_backends}
+NETNS=flow_scope_bench
+
+if [[ $EUID -ne 0 ]]; then
+    echo "Error: Please run as root (for ip netns)"
+    exit 1
+fi
+
+cleanup() {
+    ip netns del "$NETNS" 2>/dev/null || true
+}
+trap cleanup EXIT
+
+for n in 10 1000 10000; do
+    cleanup
+    ip netns add "$NETNS"
+
+    # 用 ip -batch 批量创建，比逐条调用快得多
+    batch=$(mktemp)
+    for ((i = 0; i < n / 2; i++)); do
+        echo "link add va$i type veth peer name vb$i"
+    done > "$batch"
+    ip -n "$NETNS" -batch "$batch"
+    rm -f "$batch"
+
+    iters=$((n >= 10000 ? 20 : 200))
+    echo "[*] $n interfaces"
+    ip netns exec "$NETNS" "$BENCH_BIN" "$iters"
+done